@@ -0,0 +1,249 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "compiler.h"
+#include "parallel_marker.h"
+#include "scan_kernels.h"
+#include "scanner.h"
+#include "vm.h"
+
+// Benchmark names are part of the JSON output, keep them stable so runs
+// from different commits line up (compare.py from Google Benchmark diffs
+// two --benchmark_out files by name).
+
+// A mixed source to scan and compile: functions, closures, loops, strings.
+static const char *SAMPLE_SOURCE =
+    "func fib(n) {\n"
+    "  if (n <= 1) return n;\n"
+    "  return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "func makeCounter() {\n"
+    "  var count = 0;\n"
+    "  func counter() { count = count + 1; return count; }\n"
+    "  return counter;\n"
+    "}\n"
+    "var counter = makeCounter();\n"
+    "var str = \"\";\n"
+    "for (var i = 0; i < 10; i = i + 1) {\n"
+    "  str = str + \"item \" + i + \", \";\n"
+    "  if (i >= 5 and counter() != nil) print(\"fib(\" + i + \") = \" + fib(i));\n"
+    "}\n"
+    "var a = [1, 2.5, \"three\", true, nil];\n"
+    "var m = {\"key\": a, 2: \"two\"};\n"
+    "while (a.length > 0) pop(a);\n";
+
+// Each copy goes in its own function, a single chunk would run out of
+// constant slots.
+static std::string repeatSource(int copies) {
+  std::string source;
+  for (int i = 0; i < copies; i++)
+    source += "func sample" + std::to_string(i) + "() {\n" + SAMPLE_SOURCE + "}\n";
+  return source;
+}
+
+// Releases what a bare Compiler produced; without a VM nobody else will.
+static void deleteObjectGraph(AsasObject *root) {
+  std::vector<AsasObject*> objects{root};
+  std::unordered_set<AsasObject*> seen{root};
+  for (size_t i = 0; i < objects.size(); i++) {
+    forEachReference(objects[i], [&](AsasObject *ref) {
+      if (ref != nullptr && seen.insert(ref).second) objects.push_back(ref);
+    });
+  }
+  for (AsasObject *object : objects) delete object;
+}
+
+static void BM_ScanTokens(benchmark::State &state) {
+  std::string source = repeatSource(static_cast<int>(state.range(0)));
+  size_t tokens = 0;
+  for (auto _ : state) {
+    Scanner scanner(source.data(), source.size());
+    for (;;) {
+      Token token = scanner.scanToken();
+      benchmark::DoNotOptimize(token);
+      tokens++;
+      if (token.type == TOKEN_EOF) break;
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+  state.counters["tokens"] = benchmark::Counter(static_cast<double>(tokens), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ScanTokens)->Arg(1)->Arg(64);
+
+// Machine-written code: deep indentation, long names, long strings and
+// comment banners, the long runs the vector scanner kernels are for.
+static std::string generatedSource(int lines) {
+  std::string source;
+  for (int i = 0; i < lines; i++) {
+    std::string indent(4 * (1 + i % 8), ' ');
+    source += indent + "// ------------------------------------------------------------ generated " +
+              std::to_string(i) + "\n";
+    source += indent + "var generated_table_entry_identifier_" + std::to_string(i) +
+              " = \"lorem ipsum dolor sit amet, consectetur adipiscing elit " + std::to_string(i) + "\";\n";
+  }
+  return source;
+}
+
+// The same scan with each scanner kernel table; a level the CPU lacks is
+// skipped. Args: SimdLevel, then 0 for SAMPLE_SOURCE or 1 for generated
+// code.
+static void BM_ScanKernels(benchmark::State &state) {
+  const ScanKernels *kernels = scanKernelsFor(static_cast<SimdLevel>(state.range(0)));
+  if (kernels == nullptr) {
+    state.SkipWithError("not supported on this CPU");
+    return;
+  }
+  std::string source = state.range(1) == 0 ? repeatSource(64) : generatedSource(2000);
+  for (auto _ : state) {
+    Scanner scanner(source.data(), source.size(), *kernels);
+    while (scanner.scanToken().type != TOKEN_EOF) {}
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+  state.SetLabel(kernels->name);
+}
+BENCHMARK(BM_ScanKernels)->ArgsProduct({
+    {static_cast<int>(SimdLevel::SCALAR), static_cast<int>(SimdLevel::SSE4_2), static_cast<int>(SimdLevel::AVX2)},
+    {0, 1}});
+
+static void BM_Compile(benchmark::State &state) {
+  std::string source = repeatSource(static_cast<int>(state.range(0)));
+  for (auto _ : state) {
+    AsasString *scriptName = AsasString::create("<script>", 8);
+    Compiler compiler(source.c_str(), scriptName, FunctionType::SCRIPT);
+    AsasFunction *function = compiler.compile();
+    if (function == nullptr) {
+      delete scriptName;
+      state.SkipWithError("compile error");
+      break;
+    }
+    state.PauseTiming();
+    deleteObjectGraph(function);
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+BENCHMARK(BM_Compile)->Arg(1)->Arg(64);
+
+// 120 top-level functions, about as many as the script's constant slots
+// allow; 0 compiles them sequentially, N on N threads (a gain only with
+// as many cores).
+static void BM_CompileParallel(benchmark::State &state) {
+  std::string source = repeatSource(120);
+  unsigned threads = static_cast<unsigned>(state.range(0));
+  for (auto _ : state) {
+    AsasString *scriptName = AsasString::create("<script>", 8);
+    Compiler compiler(source.data(), source.size(), scriptName, FunctionType::SCRIPT);
+    compiler.setParallelCompile(threads == 0 ? SIZE_MAX : 0, threads);
+    AsasFunction *function = compiler.compile();
+    if (function == nullptr) {
+      delete scriptName;
+      state.SkipWithError("compile error");
+      break;
+    }
+    state.PauseTiming();
+    deleteObjectGraph(function);
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+}
+BENCHMARK(BM_CompileParallel)->Arg(0)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// Runs a whole script per iteration on one VM. The script cache keeps the
+// compiled function, so this measures execution; reset() drops the
+// globals between iterations and output goes nowhere.
+static void runScript(benchmark::State &state, const std::string &source) {
+  VM vm;
+  vm.setOutputSink(std::make_unique<CallbackOutputSink>([](const char*, size_t) {}));
+  for (auto _ : state) {
+    if (vm.interpret(source.c_str()) != INTERPRET_OK) {
+      state.SkipWithError("script failed");
+      break;
+    }
+    vm.reset();
+  }
+}
+
+static void BM_ArithmeticLoop(benchmark::State &state) {
+  runScript(state,
+      "var total = 0;\n"
+      "for (var i = 0; i < 100000; i = i + 1) total = total + i * 2 - i / 2;\n");
+}
+BENCHMARK(BM_ArithmeticLoop);
+
+static void BM_Fib(benchmark::State &state) {
+  runScript(state,
+      "func fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+      "fib(20);\n");
+}
+BENCHMARK(BM_Fib);
+
+static void BM_ClosureCreation(benchmark::State &state) {
+  runScript(state,
+      "func make(n) { func get() { return n; } return get; }\n"
+      "var total = 0;\n"
+      "for (var i = 0; i < 20000; i = i + 1) total = total + make(i)();\n");
+}
+BENCHMARK(BM_ClosureCreation);
+
+static void BM_StringConcat(benchmark::State &state) {
+  runScript(state,
+      "var str = \"\";\n"
+      "for (var i = 0; i < 20000; i = i + 1) str = str + \"ab\";\n"
+      "var length = str.length;\n");
+}
+BENCHMARK(BM_StringConcat);
+
+static void BM_GlobalAccess(benchmark::State &state) {
+  runScript(state,
+      "var a = 1; var b = 2; var c = 0;\n"
+      "for (var i = 0; i < 100000; i = i + 1) c = a + b + c;\n");
+}
+BENCHMARK(BM_GlobalAccess);
+
+static void BM_GcChurn(benchmark::State &state) {
+  runScript(state,
+      "for (var i = 0; i < 50000; i = i + 1) { var pair = [i, \"x\" + i]; }\n");
+}
+BENCHMARK(BM_GcChurn);
+
+// Macro benchmarks: every .as file in ASAS_BENCH_SCRIPT_DIRS, registered
+// as BM_Script/<file name>.
+static void registerScripts() {
+  std::stringstream dirs(ASAS_BENCH_SCRIPT_DIRS);
+  std::vector<std::filesystem::path> files;
+  for (std::string dir; std::getline(dirs, dir, ':');) {
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, error))
+      if (entry.path().extension() == ".as") files.push_back(entry.path());
+  }
+  std::sort(files.begin(), files.end());
+
+  for (const auto &path : files) {
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    benchmark::RegisterBenchmark(("BM_Script/" + path.stem().string()).c_str(),
+        [source = contents.str()](benchmark::State &state) { runScript(state, source); });
+  }
+}
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::AddCustomContext("asas_commit", ASAS_GIT_COMMIT);
+#ifdef NDEBUG
+  benchmark::AddCustomContext("asas_build", "release");
+#else
+  benchmark::AddCustomContext("asas_build", "debug");
+#endif
+  registerScripts();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,16 @@
+// Allocation-heavy: builds and walks complete binary trees made of arrays.
+func bottomUp(depth) {
+  if (depth == 0) return [nil, nil];
+  return [bottomUp(depth - 1), bottomUp(depth - 1)];
+}
+
+func check(tree) {
+  if (tree[0] == nil) return 1;
+  return 1 + check(tree[0]) + check(tree[1]);
+}
+
+var total = 0;
+for (var depth = 4; depth <= 12; depth = depth + 2) {
+  for (var i = 0; i < 8; i = i + 1) total = total + check(bottomUp(depth));
+}
+print total;
@@ -0,0 +1,17 @@
+// Map-heavy: counts generated words, then sums the counts back.
+var words = ["alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta"];
+var counts = {};
+for (var round = 0; round < 50; round = round + 1) {
+  for (var w = 0; w < words.length; w = w + 1) {
+    for (var bucket = 0; bucket < 50; bucket = bucket + 1) {
+      var word = words[w] + bucket;
+      if (has(counts, word)) counts[word] = counts[word] + 1;
+      else counts[word] = 1;
+    }
+  }
+}
+
+var total = 0;
+var k = keys(counts);
+for (var i = 0; i < k.length; i = i + 1) total = total + counts[k[i]];
+print total;
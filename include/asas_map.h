@@ -0,0 +1,64 @@
+#ifndef asas_asas_map_h
+#define asas_asas_map_h
+
+#include <cstdint>
+#include <memory>
+#include "object.h"
+
+// Each slot has a control byte. EMPTY and DELETED are negative. A full
+// slot holds the low 7 bits of its key's hash (h2), so a single SIMD
+// compare picks the candidates out of a group of 16 slots.
+#define MAP_GROUP_SIZE 16
+#define MAP_CTRL_EMPTY static_cast<int8_t>(-128)
+#define MAP_CTRL_DELETED static_cast<int8_t>(-2)
+
+// Script-level dictionary keyed by any Value. It is an open-addressing
+// Swiss table: slots are split into groups of MAP_GROUP_SIZE, and a lookup
+// probes whole groups, using the remaining hash bits (h1) to pick the
+// first one. The table grows at 7/8 load. Strings compare by content and
+// hash through AsasString::getHash(). Ropes must be flattened before
+// they reach the map. Every other object compares by identity.
+class AsasMap : public AsasObject {
+public:
+  AsasMap() : AsasObject(ObjectKind::MAP) { Isolate::current().objectCreated(ObjectKind::MAP); }
+  ~AsasMap() override { Isolate::current().objectDestroyed(ObjectKind::MAP); }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::MAP); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::MAP); }
+
+  bool get(const Value &key, Value &value) const;
+  // returns true when the key was not in the map yet
+  bool set(const Value &key, const Value &value);
+  bool remove(const Value &key);
+  bool contains(const Value &key) const { return find(key, hashValue(key)) != NOT_FOUND; }
+
+  size_t size() const { return used_; }
+  size_t capacity() const { return capacity_; }
+
+  template<typename Fn>
+  void forEach(Fn &&fn) const {
+    for (size_t i = 0; i < capacity_; i++)
+      if (ctrl_[i] >= 0) fn(slots_[i].key, slots_[i].value);
+  }
+
+  static uint64_t hashValue(const Value &key);
+  static bool keysEqual(const Value &a, const Value &b);
+
+private:
+  struct Slot {
+    Value key;
+    Value value;
+  };
+  static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+  size_t find(const Value &key, uint64_t hash) const;
+  size_t findFreeSlot(uint64_t hash) const;
+  void rehash(size_t newCapacity);
+
+  std::unique_ptr<int8_t[]> ctrl_;
+  std::unique_ptr<Slot[]> slots_;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+  size_t tombstones_ = 0;
+};
+
+#endif // asas_asas_map_h
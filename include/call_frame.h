@@ -0,0 +1,45 @@
+#ifndef asas_call_frame_h
+#define asas_call_frame_h
+
+#include "debug.h"
+#include "object.h"
+
+#define STACK_MAX 256
+
+class CallFrame {
+public:
+  // CallFrame(AsasFunction *function, size_t slotStartIndex)
+  //     : ip_(function->getChunk()->getCode().data()),
+  //       function_(function), slotStartIndex_(slotStartIndex) { }
+  CallFrame(AsasClosure *closure, size_t slotStartIndex)
+      : ip_(closure->getFunction()->getChunk()->getCode().data()),
+        closure_(closure),
+        function_(closure->getFunction()),
+        slotStartIndex_(static_cast<int>(slotStartIndex)) { }
+
+  const uint8_t readByte() { return *ip_++; }
+  const uint16_t readShort() { return (uint16_t)((readByte() << 8) | readByte()); }
+  const Value readConstant() { return function_->getChunk()->getConstantAt(readByte()); }
+  const void incrementIP(int offset) { ip_ += offset; }
+  const uint8_t getSlot() { return readByte() + slotStartIndex_; }
+  uint8_t getSlotAt(int index) { return slotStartIndex_ + index; }
+  int getSlotStartIndex() const { return slotStartIndex_; }
+  const void debugCF(int frameIndex) {
+    size_t offset = static_cast<size_t>(ip_ - function_->getChunk()->getCode().data());
+    DebugChunk::disassembleInstruction(*function_->getChunk(), offset, frameIndex);
+  }
+  int getCurrentLine() const {
+    size_t offset = static_cast<size_t>(ip_ - function_->getChunk()->getCode().data()) - 1;
+    return function_->getChunk()->getLineAt(offset);
+  }
+  AsasFunction* getFunction() const { return function_; }
+  AsasClosure* getClosure() const { return closure_; }
+
+private:
+  const uint8_t *ip_;
+  AsasClosure *closure_;
+  AsasFunction *function_;
+  const int slotStartIndex_;
+};
+
+#endif // asas_call_frame_h
@@ -33,7 +33,15 @@ enum OpCode : uint8_t {
   OP_CALL,
   OP_CLOSURE,
   OP_CLOSE_UPVALUE,
+  OP_ARRAY,
+  OP_MAP,
+  OP_GET_INDEX,
+  OP_SET_INDEX,
+  OP_LENGTH,
+  OP_YIELD,
+  OP_RESUME,
   OP_RETURN,
+  OP_COUNT // number of opcodes, keep last
 };
 
 class Chunk {
@@ -52,7 +60,7 @@ public:
   const std::vector<uint8_t> &getCode() const { return code_; }
   void setAt(size_t index, uint8_t byte) { code_[index] = byte; }
   // std::vector<Value>& &getConstants() { return constants_.getValues();}
-  const std::vector<Value>& getConstants() { return constants_.getValues();}
+  const std::vector<Value>& getConstants() const { return constants_.getValues();}
 
   ~Chunk() = default;
 
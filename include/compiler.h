@@ -1,6 +1,12 @@
 #ifndef asas_compiler_h
 #define asas_compiler_h
 
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include "chunk.h"
 #include "debug.h"
 #include "object.h"
@@ -52,18 +58,78 @@ public:
   bool panicMode;
 };
 
+// Bytes of a compile's arena that come with the session itself; a script
+// whose locals, upvalues and name tables outgrow them takes more from the
+// heap, in growing blocks.
+#define COMPILER_ARENA_INLINE_BYTES (4 * 1024)
+
+// Sources at least this many bytes long are compiled in two phases: a
+// pre-scan finds the top-level functions by brace matching, worker threads
+// compile each of them apart, and the script is then compiled in order
+// with every function that compiled cleanly linked in where it stands.
+// The result is the bytecode the sequential compile makes, byte for byte;
+// a function that doesn't compile on its own is compiled in place, so its
+// errors come out where they always did.
+#define COMPILER_PARALLEL_THRESHOLD (64 * 1024)
+#define COMPILER_MAX_THREADS 16
+
+// A top-level function compiled apart from its script: the pre-scan finds
+// where it is, a worker compiles it. `objects` is everything that compile
+// made, the function included.
+struct PrecompiledFunction {
+  Token name;
+  const char *end = nullptr; // past the closing brace
+  int endLine = 0;
+  AsasFunction *function = nullptr; // nullptr if it didn't compile on its own
+  std::vector<AsasObject*> objects;
+};
+
+// The state a compile needs only while it runs, shared by the compiler of
+// the script and those of the functions nested in it: the one scanner and
+// parser every token passes through, and an arena for the locals, upvalues
+// and name tables, released in one go with the session. The objects the
+// compile makes are listed so a failed compile can free them; a successful
+// one hands them to the GC through the function it returns.
+class CompileSession {
+public:
+  explicit CompileSession(const Scanner &scanner)
+      : scanner(scanner), arena(inlineBytes_, sizeof(inlineBytes_)), created(&arena) {}
+  CompileSession(const CompileSession&) = delete;
+  CompileSession& operator=(const CompileSession&) = delete;
+  // frees the precompiled functions the link step never reached
+  ~CompileSession();
+
+private:
+  alignas(std::max_align_t) char inlineBytes_[COMPILER_ARENA_INLINE_BYTES];
+
+public:
+  Scanner scanner;
+  Parser parser;
+  std::pmr::monotonic_buffer_resource arena;
+  std::pmr::vector<AsasObject*> created;
+  // off on the workers: what fails there is compiled again in place
+  bool reportErrors = true;
+  // in source order; the link step takes them as it gets there
+  std::vector<PrecompiledFunction> precompiled;
+  size_t nextPrecompiled = 0;
+};
+
 class Compiler {
 public:
+  Compiler(const Scanner &scanner, AsasString *fnName, FunctionType type = SCRIPT)
+      : Compiler(std::make_unique<CompileSession>(scanner), nullptr, fnName, type) {}
+  Compiler(const char *source, size_t length, AsasString *fnName, FunctionType type = SCRIPT)
+      : Compiler(Scanner(source, length), fnName, type) {}
   Compiler(const char *source, AsasString *fnName, FunctionType type = SCRIPT)
-      : scanner_(source), enclosing_(nullptr),
-        currentFunction_(new AsasFunction(new Chunk(), fnName)), 
-        currentFunctionType_(type)
-  {
-    Token token(TOKEN_FUNC, "func_main", 0, 0);
-    locals_.push_back(LocalVariable(token, 0));
-  }
+      : Compiler(Scanner(source), fnName, type) {}
 
   AsasFunction *compile();
+  // Sources from `thresholdBytes` on take the parallel path, on up to
+  // `threads` threads (0: one per core, at most COMPILER_MAX_THREADS).
+  void setParallelCompile(size_t thresholdBytes, unsigned threads = 0) {
+    parallelThreshold_ = thresholdBytes;
+    parallelThreads_ = threads;
+  }
 
   void declaration();
   void varDeclaration();
@@ -86,6 +152,10 @@ public:
 
   void expression();
   void call(bool canAssign);
+  void arrayLiteral(bool canAssign);
+  void mapLiteral(bool canAssign);
+  void index(bool canAssign);
+  void dot(bool canAssign);
   void grouping(bool canAssign);
   void variable(bool canAssign);
   void string(bool canAssign);
@@ -96,19 +166,42 @@ public:
   void defineVariable(uint8_t global);
   void andOperator(bool canAssign);
   void orOperator(bool canAssign);
+  void yieldExpression(bool canAssign);
+  void resumeExpression(bool canAssign);
 
   int resolveUpvalue(const Token &name);
   int addUpvalue(uint8_t index, bool isLocal);
 
 private:
-  Parser parser_;
-  Scanner scanner_;
+  // the script's compiler owns the session, a nested one shares it
+  Compiler(std::unique_ptr<CompileSession> ownSession, Compiler *enclosing, AsasString *fnName,
+           FunctionType type);
+
+  std::unique_ptr<CompileSession> ownSession_;
+  CompileSession &session_;
+  Parser &parser_;
+  Scanner &scanner_;
   Compiler *enclosing_;
   AsasFunction* currentFunction_;
-  std::vector<Upvalue> upvalues_;
+  std::pmr::vector<Upvalue> upvalues_;
   FunctionType currentFunctionType_;
-  std::vector<LocalVariable> locals_;
+  std::pmr::vector<LocalVariable> locals_;
+  // the constant of every global name used so far, one per name
+  std::pmr::unordered_map<std::string_view, uint8_t> nameConstants_;
   int scopeDepth_ = 0;
+  size_t parallelThreshold_ = COMPILER_PARALLEL_THRESHOLD;
+  unsigned parallelThreads_ = 0;
+
+  void precompileFunctions();
+  static void precompile(const Scanner &scanner, PrecompiledFunction &part);
+  bool linkPrecompiled();
+
+  // a string constant; freed again if the compile fails
+  AsasString *newString(const char *chars, int length) {
+    AsasString *string = AsasString::create(chars, length);
+    session_.created.push_back(string);
+    return string;
+  }
 
   void addLocal(const Token &name);
   Chunk *currentChunk() { return currentFunction_->getChunk(); }
@@ -8,6 +8,7 @@ class DebugChunk {
 public:
   static void disassembleChunk(const Chunk &chunk, const char *name);
   static int disassembleInstruction(const Chunk &chunk, int offset, int nestedLevel = 0);
+  static const char *opcodeName(uint8_t opcode);
 
 private:
   static int disassembleInstruction_(const Chunk &chunk, int offset);
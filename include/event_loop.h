@@ -0,0 +1,56 @@
+#ifndef asas_event_loop_h
+#define asas_event_loop_h
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Single-threaded epoll loop behind the async natives. Timers share one
+// timerfd armed for the earliest deadline; file descriptors are watched
+// one-shot, so every callback runs exactly once and a new wait has to be
+// registered for the next event.
+class EventLoop {
+public:
+  using Callback = std::function<void()>;
+
+  EventLoop();
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+  ~EventLoop();
+
+  void addTimer(double seconds, Callback callback);
+  // false when fd is already watched or cannot be polled (regular files)
+  bool watchReadable(int fd, Callback callback);
+  bool watchWritable(int fd, Callback callback);
+
+  bool hasPending() const { return !timers_.empty() || !watches_.empty(); }
+  // Blocks until something is due (at most timeoutMs, -1 = no limit) and
+  // runs the callbacks; returns how many ran.
+  size_t runOnce(int timeoutMs = -1);
+
+private:
+  struct Timer {
+    uint64_t deadline; // CLOCK_MONOTONIC, nanoseconds
+    uint64_t sequence; // keeps timers with the same deadline in FIFO order
+    Callback callback;
+  };
+  struct TimerLater {
+    bool operator()(const Timer &a, const Timer &b) const {
+      return a.deadline != b.deadline ? a.deadline > b.deadline : a.sequence > b.sequence;
+    }
+  };
+
+  bool watch(int fd, uint32_t events, Callback callback);
+  void armTimer();
+  size_t runDueTimers();
+
+  int epollFd_;
+  int timerFd_;
+  uint64_t timerSequence_ = 0;
+  std::priority_queue<Timer, std::vector<Timer>, TimerLater> timers_;
+  std::unordered_map<int, Callback> watches_;
+};
+
+#endif // asas_event_loop_h
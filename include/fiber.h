@@ -0,0 +1,54 @@
+#ifndef asas_fiber_h
+#define asas_fiber_h
+
+#include <bitset>
+#include <unordered_map>
+#include <vector>
+#include "call_frame.h"
+#include "object.h"
+
+// A coroutine: a closure with its own value stack, call frames and open
+// upvalues. The VM never copies a context. resume swaps the fiber's vectors
+// with the VM's live ones, and yield swaps them back. While a fiber runs,
+// its object holds the suspended context of whoever resumed it; that one
+// is found again through getCaller().
+class AsasFiber : public AsasObject {
+public:
+  // FIBER_WAITING: suspended inside an async native, only the event loop
+  // may resume it
+  enum State { FIBER_NEW, FIBER_SUSPENDED, FIBER_WAITING, FIBER_RUNNING, FIBER_DONE };
+
+  explicit AsasFiber(AsasClosure *closure)
+      : AsasObject(ObjectKind::FIBER), closure_(closure), caller_(nullptr), state_(FIBER_NEW)
+  {
+    Isolate::current().objectCreated(ObjectKind::FIBER);
+    // upvalues point into the stack, it must never reallocate
+    stack_.reserve(STACK_MAX);
+  }
+  ~AsasFiber() override { Isolate::current().objectDestroyed(ObjectKind::FIBER); }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::FIBER); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::FIBER); }
+
+  AsasClosure *getClosure() const { return closure_; }
+  AsasFiber *getCaller() const { return caller_; }
+  void setCaller(AsasFiber *caller) { caller_ = caller; }
+  State getState() const { return state_; }
+  void setState(State state) { state_ = state; }
+  bool isDone() const { return state_ == FIBER_DONE; }
+
+  std::vector<Value> &getStack() { return stack_; }
+  std::bitset<STACK_MAX> &getMarkedFlags() { return markedFlags_; }
+  std::vector<CallFrame> &getCallFrames() { return callFrames_; }
+  std::unordered_map<Value*, AsasUpvalue*> &getOpenUpvalues() { return openUpvalues_; }
+
+private:
+  AsasClosure *closure_;
+  AsasFiber *caller_;
+  State state_;
+  std::vector<Value> stack_;
+  std::bitset<STACK_MAX> markedFlags_;
+  std::vector<CallFrame> callFrames_;
+  std::unordered_map<Value*, AsasUpvalue*> openUpvalues_;
+};
+
+#endif // asas_fiber_h
@@ -0,0 +1,67 @@
+#ifndef asas_float64_array_h
+#define asas_float64_array_h
+
+#include <cstddef>
+#include <vector>
+#include "object.h"
+#include "simd_level.h"
+
+// Bulk numeric kernels over raw double buffers. There is one table per
+// instruction set; float64Kernels() picks the widest one the CPU supports
+// the first time it is called. The vector versions add in a different
+// order than the scalar loop, so sum() and dot() may differ from it in the
+// last bits.
+struct Float64Kernels {
+  const char *name;
+  double (*sum)(const double *values, size_t count);
+  double (*dot)(const double *left, const double *right, size_t count);
+  void (*scale)(double *values, size_t count, double factor);
+  // left[i] += right[i]
+  void (*add)(double *left, const double *right, size_t count);
+  // count must be > 0
+  double (*min)(const double *values, size_t count);
+  double (*max)(const double *values, size_t count);
+  // inclusive running sum, in place
+  void (*prefixSum)(double *values, size_t count);
+};
+
+const Float64Kernels &float64Kernels();
+// nullptr when this build or this CPU can't run that level
+const Float64Kernels *float64KernelsFor(SimdLevel level);
+
+// Fixed-length array of unboxed doubles, for numeric code that goes through
+// the bulk natives (f64Sum, f64Dot, f64Scale, f64Add, f64Min, f64Max,
+// f64PrefixSum) instead of element-by-element bytecode loops. Indexing works
+// like AsasArray but only stores numbers.
+class AsasFloat64Array : public AsasObject {
+public:
+  explicit AsasFloat64Array(size_t length)
+      : AsasObject(ObjectKind::FLOAT64_ARRAY), elements_(length, 0.0) {
+    Isolate::current().objectCreated(ObjectKind::FLOAT64_ARRAY);
+  }
+  explicit AsasFloat64Array(std::vector<double> elements)
+      : AsasObject(ObjectKind::FLOAT64_ARRAY), elements_(std::move(elements)) {
+    Isolate::current().objectCreated(ObjectKind::FLOAT64_ARRAY);
+  }
+  ~AsasFloat64Array() override { Isolate::current().objectDestroyed(ObjectKind::FLOAT64_ARRAY); }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::FLOAT64_ARRAY); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::FLOAT64_ARRAY); }
+
+  size_t size() const { return elements_.size(); }
+  double at(size_t index) const { return elements_[index]; }
+  void set(size_t index, double value) { elements_[index] = value; }
+  double *data() { return elements_.data(); }
+  const double *data() const { return elements_.data(); }
+
+  // same rules as AsasArray::isValidIndex
+  bool isValidIndex(double index, size_t &slot) const {
+    if (!(index >= 0 && index < static_cast<double>(elements_.size()))) return false;
+    slot = static_cast<size_t>(index);
+    return static_cast<double>(slot) == index;
+  }
+
+private:
+  std::vector<double> elements_;
+};
+
+#endif // asas_float64_array_h
@@ -0,0 +1,60 @@
+#ifndef asas_gc_stats_h
+#define asas_gc_stats_h
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "isolate.h"
+#include "object_fwd.h"
+
+#define OBJECT_KIND_COUNT static_cast<size_t>(ObjectKind::COUNT)
+
+// Collector counters of one VM, see VM::getGcStats() and the gcStats()
+// native. Byte sizes are shallow: the object itself plus the buffers it
+// owns (characters, elements, bytecode), not what it references. An object
+// is charged its size when it is registered; growth (or shrinking) of its
+// buffers is charged at each sweep, and freeing credits exactly what was
+// charged, so bytesAllocated - bytesFreed is always liveBytes.
+class GcStats {
+public:
+  uint64_t collections = 0;
+  uint64_t objectsAllocated = 0;
+  uint64_t objectsFreed = 0;
+  uint64_t bytesAllocated = 0;
+  uint64_t bytesFreed = 0;
+
+  // what is tracked right now, filled in by VM::getGcStats()
+  uint64_t liveObjects = 0;
+  uint64_t liveBytes = 0;
+  std::array<uint64_t, OBJECT_KIND_COUNT> liveObjectsByKind = {};
+  std::array<uint64_t, OBJECT_KIND_COUNT> liveBytesByKind = {};
+  // the collection runs once more than this many objects are tracked
+  uint64_t nextThreshold = 0;
+
+  // durations in nanoseconds; a pause is one whole collection
+  uint64_t markNanos = 0;
+  uint64_t sweepNanos = 0;
+  uint64_t totalPauseNanos = 0;
+  uint64_t maxPauseNanos = 0;
+  uint64_t lastPauseNanos = 0;
+
+  double averagePauseNanos() const {
+    return collections == 0 ? 0.0 : static_cast<double>(totalPauseNanos) / collections;
+  }
+  void recordPause(uint64_t markTime, uint64_t sweepTime) {
+    collections++;
+    markNanos += markTime;
+    sweepNanos += sweepTime;
+    lastPauseNanos = markTime + sweepTime;
+    totalPauseNanos += lastPauseNanos;
+    if (lastPauseNanos > maxPauseNanos) maxPauseNanos = lastPauseNanos;
+  }
+
+  std::string toJson() const;
+};
+
+ObjectKind objectKindOf(AsasObject *object);
+const char *objectKindName(ObjectKind kind);
+size_t objectByteSize(AsasObject *object);
+
+#endif // asas_gc_stats_h
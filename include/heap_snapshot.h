@@ -0,0 +1,97 @@
+#ifndef asas_heap_snapshot_h
+#define asas_heap_snapshot_h
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "object_fwd.h"
+
+// How many retainers HeapSnapshot::summary() lists by default.
+#define HEAP_SUMMARY_DEFAULT_TOP 20
+
+// The object graph of a VM in the shape of a V8 .heapsnapshot: node 0 is
+// a synthetic root whose edges lead to one synthetic node per kind of GC
+// root (the stack, the globals, the fibers, ...), and every other node is
+// an object with its shallow size (see objectByteSize()) and one edge per
+// reference it holds. toJson() writes the file Chrome DevTools and other
+// V8 heap viewers load; parse() reads it back, also when Chrome wrote it.
+//
+// summary() reports the objects that retain the most memory: the size an
+// object retains is what would become garbage without it, the sum of the
+// objects it dominates (every path from the root to them goes through it).
+class HeapSnapshot {
+public:
+  // in the order the V8 format lists them
+  enum NodeType : uint8_t {
+    HIDDEN, ARRAY, STRING, OBJECT, CODE, CLOSURE, REGEXP, NUMBER, NATIVE,
+    SYNTHETIC, CONCATENATED_STRING, SLICED_STRING, SYMBOL, BIGINT, NODE_TYPE_COUNT
+  };
+  enum EdgeType : uint8_t {
+    CONTEXT, ELEMENT, PROPERTY, INTERNAL, HIDDEN_EDGE, SHORTCUT, WEAK, EDGE_TYPE_COUNT
+  };
+
+  struct Edge {
+    EdgeType type;
+    uint32_t nameOrIndex; // a string for named edges, an index for ELEMENT and HIDDEN_EDGE
+    uint32_t to;
+  };
+  struct Node {
+    NodeType type;
+    uint32_t name; // into getStrings()
+    uint64_t id;
+    uint64_t selfSize;
+    std::vector<Edge> edges;
+  };
+
+  // One line of summary(), biggest retained size first.
+  struct Retainer {
+    uint32_t node;
+    uint32_t dominator;
+    uint64_t retainedSize;
+    uint32_t dominatedCount; // nodes it retains, itself included
+  };
+
+  uint32_t addNode(NodeType type, const std::string &name, uint64_t selfSize);
+  void addEdge(uint32_t from, EdgeType type, const std::string &name, uint32_t to);
+  void addEdge(uint32_t from, EdgeType type, uint32_t index, uint32_t to);
+
+  // The node of `object`, added the first time it is seen. Its references
+  // are added by the next addReferences(), which follows them until every
+  // object reachable from the added ones has its node.
+  uint32_t addObject(AsasObject *object);
+  void addReferences();
+
+  const std::vector<Node> &getNodes() const { return nodes_; }
+  const std::vector<std::string> &getStrings() const { return strings_; }
+  const std::string &nameOf(uint32_t node) const { return strings_[nodes_[node].name]; }
+  // "closure fib", "string \"abc\"", "(globals)"
+  std::string describe(uint32_t node) const;
+
+  std::string toJson() const;
+  // false, with `error` set, if `json` isn't a heap snapshot
+  static bool parse(const std::string &json, HeapSnapshot &snapshot, std::string &error);
+
+  // The immediate dominator of every node; the root dominates itself and
+  // nodes it can't reach get UINT32_MAX. WEAK edges don't retain.
+  std::vector<uint32_t> dominators() const;
+  std::vector<Retainer> biggestRetainers(size_t count) const;
+  std::string summary(size_t count = HEAP_SUMMARY_DEFAULT_TOP) const;
+
+  static const char *nodeTypeName(NodeType type);
+  static const char *edgeTypeName(EdgeType type);
+
+private:
+  uint32_t intern(const std::string &string);
+  // also fills `postorder` with the reachable nodes, the root last
+  std::vector<uint32_t> dominators(std::vector<uint32_t> &postorder) const;
+
+  std::vector<Node> nodes_;
+  std::vector<std::string> strings_;
+  std::unordered_map<std::string, uint32_t> stringIndex_;
+
+  std::unordered_map<const AsasObject*, uint32_t> objectNodes_;
+  std::vector<std::pair<AsasObject*, uint32_t>> unexpanded_;
+};
+
+#endif // asas_heap_snapshot_h
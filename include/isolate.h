@@ -0,0 +1,77 @@
+#ifndef asas_isolate_h
+#define asas_isolate_h
+
+#include <atomic>
+#include <cstdint>
+
+enum class ObjectKind : uint8_t {
+  OBJECT,
+  STRING,
+  ROPE,
+  FUNCTION,
+  NATIVE_FUNCTION,
+  UPVALUE,
+  CLOSURE,
+  FIBER,
+  ARRAY,
+  MAP,
+  FLOAT64_ARRAY,
+  COUNT
+};
+
+// Bookkeeping that used to live in process-wide statics. Every VM belongs
+// to one isolate and installs it as the current one (IsolateScope) while it
+// runs, so objects are counted against the isolate that made them and VMs
+// on different threads never touch the same counters. Threads that never
+// install one get their own default isolate.
+class Isolate {
+public:
+  Isolate() { resetObjectCounts(); }
+  Isolate(const Isolate&) = delete;
+  Isolate& operator=(const Isolate&) = delete;
+
+  static Isolate &current() {
+    if (current_ == nullptr) current_ = &threadDefault();
+    return *current_;
+  }
+
+  void objectCreated(ObjectKind kind) {
+    objectCounts_[static_cast<int>(kind)].fetch_add(1, std::memory_order_relaxed);
+  }
+  void objectDestroyed(ObjectKind kind) {
+    objectCounts_[static_cast<int>(kind)].fetch_sub(1, std::memory_order_relaxed);
+  }
+  int getObjectCount(ObjectKind kind) const {
+    return objectCounts_[static_cast<int>(kind)].load(std::memory_order_relaxed);
+  }
+  void resetObjectCount(ObjectKind kind) {
+    objectCounts_[static_cast<int>(kind)].store(0, std::memory_order_relaxed);
+  }
+  void resetObjectCounts();
+  int nextObjectPosition() { return totalObjects_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+  friend class IsolateScope;
+  static Isolate &threadDefault();
+
+  std::atomic<int> objectCounts_[static_cast<int>(ObjectKind::COUNT)];
+  std::atomic<int> totalObjects_{0};
+
+  static constinit inline thread_local Isolate *current_ = nullptr;
+};
+
+// Makes `isolate` the current one on this thread until the scope ends.
+class IsolateScope {
+public:
+  explicit IsolateScope(Isolate &isolate) : previous_(Isolate::current_) {
+    Isolate::current_ = &isolate;
+  }
+  ~IsolateScope() { Isolate::current_ = previous_; }
+  IsolateScope(const IsolateScope&) = delete;
+  IsolateScope& operator=(const IsolateScope&) = delete;
+
+private:
+  Isolate *previous_;
+};
+
+#endif // asas_isolate_h
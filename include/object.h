@@ -1,88 +1,222 @@
 #ifndef asas_object_h
 #define asas_object_h
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <string>
 #include <vector>
 #include <functional>
+#include <new>
 #include "chunk.h"
+#include "isolate.h"
+#include "object_arena.h"
 
 class AsasObject {
 public:
-  AsasObject() : position_(refTotalObjects_++)
+  // the kind of the most derived class, so the collector and the heap
+  // tools can tell objects apart without a chain of dynamic_casts
+  explicit AsasObject(ObjectKind kind = ObjectKind::OBJECT)
+      : position_(Isolate::current().nextObjectPosition()), kind_(kind)
   { 
-    refCountObjects_++; 
+    Isolate::current().objectCreated(ObjectKind::OBJECT);
   }
   AsasObject(const AsasObject&) = delete;
   AsasObject& operator=(const AsasObject&) = delete;
-  virtual ~AsasObject() { refCountObjects_--; }
-  static int getRefCountObjects()  { return refCountObjects_; }
-  static void resetRefCounts() { refCountObjects_ = 0; }
-  bool isMarked() const { return isMarked_; }
-  void mark() { isMarked_ = true; }
-  void unmark() { isMarked_ = false; }
+  virtual ~AsasObject() { Isolate::current().objectDestroyed(ObjectKind::OBJECT); }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::OBJECT); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::OBJECT); }
+  bool isMarked() const { return isMarked_.load(std::memory_order_relaxed); }
+  void mark() { isMarked_.store(true, std::memory_order_relaxed); }
+  void unmark() { isMarked_.store(false, std::memory_order_relaxed); }
+  // Returns true only for the caller that flips the bit, so concurrent
+  // markers never trace the same object twice. Shared objects are never
+  // marked: they belong to no VM and no collector walks into them.
+  bool tryMark() {
+    if (isShared_ || isMarked()) return false;
+    return !isMarked_.exchange(true, std::memory_order_acq_rel);
+  }
   int getPosition() const { return position_; }
+  ObjectKind getKind() const { return kind_; }
+  uint8_t getSizeClass() const { return sizeClass_; }
+  void setSizeClass(uint8_t sizeClass) { sizeClass_ = sizeClass; }
+  // Set once, before the object is published to other threads.
+  bool isShared() const { return isShared_; }
+  void setShared() { isShared_ = true; }
+  // What the owning VM's byte counters were last charged for this object.
+  size_t getChargedBytes() const { return chargedBytes_; }
+  void setChargedBytes(size_t bytes) { chargedBytes_ = bytes; }
 
 private:
   int position_;
-  bool isMarked_ = false;
-  inline static int refCountObjects_ = 0;
-  inline static int refTotalObjects_ = 0;
+  std::atomic<bool> isMarked_ = false;
+  uint8_t sizeClass_ = ObjectArena::HEAP_CLASS;
+  ObjectKind kind_;
+  bool isShared_ = false;
+  size_t chargedBytes_ = 0;
 };
 
+// The characters live right after the object header, in the same block, so
+// a string is a single allocation and short ones fit in one cache line.
+// Build strings with create() (plain heap) or construct() (caller-provided
+// memory of allocationSize(length) bytes), never with new.
 class AsasString : public AsasObject {
 public:
-  AsasString(const char *data, int length, bool isInterned = false)
-      : isInterned_(isInterned){
-    refCountObjects_++;
-
-    length_ = length;
-    this->data_ = new char[length_ + 1];
-    memcpy(this->data_, data, length_);
-    this->data_[length_] = '\0';
-#ifdef DEBUG_LOG_GC
-    printf("\033[0;32mCreated AsasString: %s: %p\033[0m\n", this->data_, (void*)this);
-#endif
+  static size_t allocationSize(int length) { return sizeof(AsasString) + length + 1; }
+  // With data == nullptr the characters are left for the caller to fill
+  // through getMutableData().
+  static AsasString *construct(void *memory, const char *data, int length, bool isInterned = false) {
+    return new (memory) AsasString(data, length, isInterned);
   }
-  AsasString(const char *data) {
-    refCountObjects_++;
-
-    length_ = strlen(data);
-    this->data_ = new char[length_ + 1];
-    memcpy(this->data_, data, length_);
-    this->data_[length_] = '\0';
-#ifdef DEBUG_LOG_GC
-    printf("\033[0;32mCreated AsasString: %s: %p\033[0m\n", this->data_, (void*)this);
-#endif
+  static AsasString *create(const char *data, int length, bool isInterned = false) {
+    return construct(::operator new(allocationSize(length)), data, length, isInterned);
+  }
+  static AsasString *create(const char *data) {
+    return create(data, static_cast<int>(strlen(data)));
   }
+  // delete of a heap string releases the whole block from create()
+  static void operator delete(void *block) { ::operator delete(block); }
+
   ~AsasString() override { 
 #ifdef DEBUG_LOG_GC
-    printf("\033[0;31mDeleted AsasString: %s: %p\033[0m\n", data_, (void*)this);
+    printf("\033[0;31mDeleted AsasString: %s: %p\033[0m\n", getData(), (void*)this);
 #endif
-    refCountObjects_--; 
-    delete[] data_;
+    Isolate::current().objectDestroyed(ObjectKind::STRING); 
   }
-  static int getRefCountObjects()  { return refCountObjects_; }
-  static void resetRefCounts() { refCountObjects_ = 0; }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::STRING); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::STRING); }
 
   int getLength() const { return length_; }
-  const char *getData() const { return data_; }
+  const char *getData() const { return reinterpret_cast<const char*>(this + 1); }
+  char *getMutableData() { return reinterpret_cast<char*>(this + 1); }
   // bool isInterned() const { return isInterned_; }
   bool canDelete() const { return !isInterned_; }
+  // FNV-1a of the characters, computed on first use. Blank strings are
+  // filled after construction, so it can't be done up front; the atomic
+  // keeps the lazy store benign when a shared string is hashed by several
+  // threads.
+  uint32_t getHash() const {
+    uint32_t hash = hash_.load(std::memory_order_relaxed);
+    if (hash != 0) return hash;
+    hash = 2166136261u;
+    const char *chars = getData();
+    for (int i = 0; i < length_; i++) {
+      hash ^= static_cast<uint8_t>(chars[i]);
+      hash *= 16777619u;
+    }
+    if (hash == 0) hash = 1; // 0 means not computed yet
+    hash_.store(hash, std::memory_order_relaxed);
+    return hash;
+  }
 private:
+  AsasString(const char *data, int length, bool isInterned)
+      : AsasObject(ObjectKind::STRING), length_(length), isInterned_(isInterned) {
+    Isolate::current().objectCreated(ObjectKind::STRING);
+
+    char *chars = getMutableData();
+    if (data != nullptr) memcpy(chars, data, length_);
+    else chars[0] = '\0';
+    chars[length_] = '\0';
+#ifdef DEBUG_LOG_GC
+    printf("\033[0;32mCreated AsasString: %s: %p\033[0m\n", getData(), (void*)this);
+#endif
+  }
+
   int length_;
-  char *data_;
   bool isInterned_;
+  mutable std::atomic<uint32_t> hash_ = 0;
+};
+
+// Lazy result of a string concatenation: the characters of `left` followed
+// by those of `right`, each either an AsasString or another AsasRope. The
+// VM flattens it into a plain AsasString the first time contiguous
+// characters are needed; after that the children are dropped and the rope
+// just forwards to the flat copy.
+class AsasRope : public AsasObject {
+public:
+  AsasRope(AsasObject *left, AsasObject *right)
+      : AsasObject(ObjectKind::ROPE), left_(left), right_(right), flat_(nullptr),
+        length_(lengthOf(left) + lengthOf(right)),
+        depth_(std::max(depthOf(left), depthOf(right)) + 1)
+  {
+    Isolate::current().objectCreated(ObjectKind::ROPE);
+#ifdef DEBUG_LOG_GC
+    printf("\033[0;32mCreated AsasRope: %d chars: %p\033[0m\n", length_, (void*)this);
+#endif
+  }
+  ~AsasRope() override {
+#ifdef DEBUG_LOG_GC
+    printf("\033[0;31mDeleted AsasRope: %p\033[0m\n", (void*)this);
+#endif
+    Isolate::current().objectDestroyed(ObjectKind::ROPE);
+  }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::ROPE); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::ROPE); }
 
-  inline static int refCountObjects_ = 0;
+  int getLength() const { return length_; }
+  int getDepth() const { return depth_; }
+  AsasObject *getLeft() const { return left_; }
+  AsasObject *getRight() const { return right_; }
+  AsasString *getFlat() const { return flat_; }
+  void setFlat(AsasString *flat) {
+    flat_ = flat;
+    left_ = right_ = nullptr;
+    depth_ = 0;
+  }
+
+  // Calls fn(chars, length) for every flat piece, left to right. Iterative,
+  // so deep left-leaning ropes built by `s = s + x` loops are fine.
+  template<typename Fn>
+  void forEachPiece(Fn &&fn) const {
+    std::vector<const AsasObject*> pending{this};
+    while (!pending.empty()) {
+      const AsasObject *node = pending.back();
+      pending.pop_back();
+      if (node->getKind() == ObjectKind::STRING) {
+        auto string = static_cast<const AsasString*>(node);
+        fn(string->getData(), string->getLength());
+        continue;
+      }
+      auto rope = static_cast<const AsasRope*>(node);
+      if (rope->flat_ != nullptr) {
+        fn(rope->flat_->getData(), rope->flat_->getLength());
+        continue;
+      }
+      pending.push_back(rope->right_);
+      pending.push_back(rope->left_);
+    }
+  }
+  void copyTo(char *out) const {
+    forEachPiece([&out](const char *chars, int length) {
+      memcpy(out, chars, length);
+      out += length;
+    });
+  }
+
+  static int lengthOf(const AsasObject *object) {
+    if (object->getKind() == ObjectKind::STRING)
+      return static_cast<const AsasString*>(object)->getLength();
+    return static_cast<const AsasRope*>(object)->getLength();
+  }
+  static int depthOf(const AsasObject *object) {
+    if (object->getKind() != ObjectKind::ROPE) return 0;
+    return static_cast<const AsasRope*>(object)->getDepth();
+  }
+
+private:
+  AsasObject *left_;
+  AsasObject *right_;
+  AsasString *flat_;
+  int length_;
+  int depth_;
 };
 
 class AsasFunction : public AsasObject {
 public:
-  AsasFunction(Chunk *chunk, AsasString *name)
-      : arity(0), name_(name), chunk_(chunk), upvalueCount_(0)
+  explicit AsasFunction(AsasString *name)
+      : AsasObject(ObjectKind::FUNCTION), arity(0), name_(name), upvalueCount_(0)
   {
-    refCountObjects_++;
+    Isolate::current().objectCreated(ObjectKind::FUNCTION);
 #ifdef DEBUG_LOG_GC
     printf("\033[0;32mCreated AsasFunction: %s: %p\033[0m\n", name_->getData(), (void*)this);
 #endif
@@ -91,18 +225,16 @@ public:
 #ifdef DEBUG_LOG_GC
     printf("\033[0;31mDeleted AsasFunction: %p\033[0m\n", (void*)this);
 #endif
-    refCountObjects_--; 
-    // delete chunk_; 
+    Isolate::current().objectDestroyed(ObjectKind::FUNCTION); 
   }
-  static int getRefCountObjects()  { return refCountObjects_; }
-  static void resetRefCounts() { refCountObjects_ = 0; }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::FUNCTION); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::FUNCTION); }
 
   std::string getName() const { return name_->getData(); }
-  Chunk *getChunk() const { return chunk_; }
+  Chunk *getChunk() { return &chunk_; }
+  const Chunk *getChunk() const { return &chunk_; }
   
-  void addInstruction(uint8_t instruction, int line) {
-    if (chunk_) chunk_->write(instruction, line);
-  }
+  void addInstruction(uint8_t instruction, int line) { chunk_.write(instruction, line); }
   int getUpvalueCount() const { return upvalueCount_; }
   void incrementUpvalueCount() { upvalueCount_++; }
   AsasString* getAsasStringName() const { return name_; }
@@ -111,23 +243,22 @@ public:
 private:
   // std::string name_;
   AsasString *name_;
-  Chunk *chunk_;
+  // the function owns its code, freed along with it
+  Chunk chunk_;
   int upvalueCount_;
-
-  inline static int refCountObjects_ = 0;
 };
 
 class AsasNativeFunction : public AsasObject {
 public:
   using NativeFn = std::function<Value(const std::vector<Value>&)>;
   AsasNativeFunction(NativeFn fn, std::string name = "")
-      : function_(std::move(fn)), name_(std::move(name))
+      : AsasObject(ObjectKind::NATIVE_FUNCTION), function_(std::move(fn)), name_(std::move(name))
   {
-    refCountObjects_++;
+    Isolate::current().objectCreated(ObjectKind::NATIVE_FUNCTION);
   }
-  ~AsasNativeFunction() override { refCountObjects_--; }
-  static int getRefCountObjects()  { return refCountObjects_; }
-  static void resetRefCounts() { refCountObjects_ = 0; }
+  ~AsasNativeFunction() override { Isolate::current().objectDestroyed(ObjectKind::NATIVE_FUNCTION); }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::NATIVE_FUNCTION); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::NATIVE_FUNCTION); }
   std::string getName() const { return name_; }
   Value call(const std::vector<Value> &args) const {
     return function_(args);
@@ -136,28 +267,26 @@ public:
 private:
   NativeFn function_;
   std::string name_;
-
-  inline static int refCountObjects_ = 0;
 };
 
 class AsasUpvalue : public AsasObject {
 public:
   explicit AsasUpvalue(Value *location)
-      : location_(location)
+      : AsasObject(ObjectKind::UPVALUE), location_(location)
   {
-    refCountObjects_++;
+    Isolate::current().objectCreated(ObjectKind::UPVALUE);
 #ifdef DEBUG_LOG_GC
     printf("\033[0;32mCreated AsasUpvalue: %p\033[0m\n", (void*)this);
 #endif
   }
   ~AsasUpvalue() override { 
-    refCountObjects_--;
+    Isolate::current().objectDestroyed(ObjectKind::UPVALUE);
 #ifdef DEBUG_LOG_GC
     printf("\033[0;31mDeleted AsasUpvalue: %p\033[0m\n", (void*)this);
 #endif
   }
-  static int getRefCountObjects()  { return refCountObjects_; }
-  static void resetRefCounts() { refCountObjects_ = 0; }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::UPVALUE); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::UPVALUE); }
   Value* getLocation() const { return location_; }
   void setLocation(Value location) { *location_ = location; }
   void close() {
@@ -168,15 +297,14 @@ public:
 private:
   Value *location_;
   Value closedValue_;
-  inline static int refCountObjects_ = 0;
 };
 
 class AsasClosure : public AsasObject {
 public:
   explicit AsasClosure(AsasFunction *function)
-      : function_(function)
+      : AsasObject(ObjectKind::CLOSURE), function_(function)
   {
-    refCountObjects_++;
+    Isolate::current().objectCreated(ObjectKind::CLOSURE);
 #ifdef DEBUG_LOG_GC
     printf("\033[0;32mCreated AsasClosure: %p\033[0m\n", (void*)this);
     printf("\033[0;32m  with function: %s: %p\033[0m\n", 
@@ -184,7 +312,7 @@ public:
 #endif
   }
   ~AsasClosure() override { 
-    refCountObjects_--;
+    Isolate::current().objectDestroyed(ObjectKind::CLOSURE);
     for (AsasUpvalue* upvalue : upvalues_) {
       // delete upvalue;
     }
@@ -192,8 +320,8 @@ public:
     printf("\033[0;31mDeleted AsasClosure: %p\033[0m\n", (void*)this);
 #endif
   }
-  static int getRefCountObjects()  { return refCountObjects_; }
-  static void resetRefCounts() { refCountObjects_ = 0; }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::CLOSURE); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::CLOSURE); }
 
   AsasFunction* getFunction() const { return function_; }
   void addUpvalue(AsasUpvalue* upvalue) {
@@ -211,7 +339,44 @@ public:
 private:
   AsasFunction *function_;
   std::vector<AsasUpvalue*> upvalues_;
-  inline static int refCountObjects_ = 0;
+};
+
+// Script-level list. Elements sit in one contiguous buffer that grows
+// geometrically, so appends are amortized O(1) and indexing is a bounds
+// check plus a load.
+class AsasArray : public AsasObject {
+public:
+  AsasArray() : AsasObject(ObjectKind::ARRAY) { Isolate::current().objectCreated(ObjectKind::ARRAY); }
+  explicit AsasArray(std::vector<Value> elements)
+      : AsasObject(ObjectKind::ARRAY), elements_(std::move(elements)) {
+    Isolate::current().objectCreated(ObjectKind::ARRAY);
+  }
+  ~AsasArray() override { Isolate::current().objectDestroyed(ObjectKind::ARRAY); }
+  static int getRefCountObjects()  { return Isolate::current().getObjectCount(ObjectKind::ARRAY); }
+  static void resetRefCounts() { Isolate::current().resetObjectCount(ObjectKind::ARRAY); }
+
+  size_t size() const { return elements_.size(); }
+  // callers check the index with isValidIndex() first
+  const Value &at(size_t index) const { return elements_[index]; }
+  void set(size_t index, const Value &value) { elements_[index] = value; }
+  void push(const Value &value) { elements_.push_back(value); }
+  Value pop() {
+    Value value = elements_.back();
+    elements_.pop_back();
+    return value;
+  }
+  const std::vector<Value> &getElements() const { return elements_; }
+
+  // An index must be a whole number in [0, size()); NaN fails the range
+  // test, so the conversion below is always defined.
+  bool isValidIndex(double index, size_t &slot) const {
+    if (!(index >= 0 && index < static_cast<double>(elements_.size()))) return false;
+    slot = static_cast<size_t>(index);
+    return static_cast<double>(slot) == index;
+  }
+
+private:
+  std::vector<Value> elements_;
 };
 
 // class AsasWrapper {
@@ -0,0 +1,64 @@
+#ifndef asas_object_arena_h
+#define asas_object_arena_h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define ARENA_SLAB_SIZE (64 * 1024)
+#define ARENA_SIZE_CLASSES 7
+
+class ArenaStats {
+public:
+  size_t slabCount = 0;
+  size_t reservedBytes = 0;  // bytes held in slabs
+  size_t liveBytes = 0;      // bytes in blocks handed out and not freed
+  size_t freeListBytes = 0;  // bytes in blocks waiting on free lists
+  size_t liveBlocks = 0;
+  size_t freeBlocks = 0;
+
+  // Share of the reserved slab memory not holding a live object.
+  double fragmentation() const {
+    return reservedBytes == 0 ? 0.0 : 1.0 - static_cast<double>(liveBytes) / reservedBytes;
+  }
+};
+
+// Slab allocator for GC objects, one set of slabs per size class. Freed
+// blocks go to an intrusive free list of their class and are handed out
+// again before the slab bump pointer advances.
+class ObjectArena {
+public:
+  static constexpr uint8_t HEAP_CLASS = 0xff;
+
+  ObjectArena() = default;
+  ObjectArena(const ObjectArena&) = delete;
+  ObjectArena& operator=(const ObjectArena&) = delete;
+  ~ObjectArena();
+
+  // Returns nullptr (and HEAP_CLASS) when `size` is bigger than the
+  // largest size class; those objects go through plain new/delete.
+  void *allocate(size_t size, uint8_t &sizeClass);
+  void deallocate(void *block, uint8_t sizeClass);
+
+  ArenaStats getStats() const;
+  static size_t getBlockSize(uint8_t sizeClass) { return blockSizes_[sizeClass]; }
+
+private:
+  struct FreeBlock { FreeBlock *next; };
+  struct SizeClass {
+    std::vector<char*> slabs;
+    char *bump = nullptr;
+    char *bumpEnd = nullptr;
+    FreeBlock *freeList = nullptr;
+    size_t liveBlocks = 0;
+    size_t freeBlocks = 0;
+  };
+
+  static uint8_t sizeClassFor(size_t size);
+  void addSlab(SizeClass &sizeClass);
+
+  static constexpr size_t blockSizes_[ARENA_SIZE_CLASSES] = {32, 48, 64, 96, 128, 192, 256};
+  SizeClass classes_[ARENA_SIZE_CLASSES];
+};
+
+#endif // asas_object_arena_h
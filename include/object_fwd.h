@@ -5,7 +5,12 @@
 // class AsasWrapper;
 class AsasObject;
 class AsasString;
+class AsasRope;
+class AsasFiber;
 class AsasFunction;
 class AsasClosure;
+class AsasArray;
+class AsasMap;
+class AsasFloat64Array;
 
 #endif // asas_object_fwd_h
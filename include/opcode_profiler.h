@@ -0,0 +1,116 @@
+#ifndef asas_opcode_profiler_h
+#define asas_opcode_profiler_h
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "chunk.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Every OPCODE_PROFILE_SAMPLE_PERIOD-th instruction is timed with the TSC;
+// timing all of them would cost more than most opcodes take.
+#define OPCODE_PROFILE_SAMPLE_PERIOD 16
+// log2 buckets of the cycle histograms: [0,1], [2,3], [4,7], ... the last
+// one takes everything longer
+#define OPCODE_PROFILE_BUCKETS 24
+
+// Rough grouping of the opcodes for the cycle histograms.
+enum class OpcodeClass : uint8_t {
+  STACK,      // constants, literals, pops
+  VARIABLE,   // globals, locals, upvalues
+  ARITHMETIC, // arithmetic, comparison, logic
+  CONTROL,    // jumps and loops
+  CALL,       // calls, returns, closures, fibers
+  OBJECT,     // arrays, maps, indexing, length
+  OUTPUT,     // print
+  COUNT
+};
+
+// Counts how often each opcode runs, which opcode follows which (to pick
+// superinstructions), and how many cycles a sample of the executions took.
+// VM::run() feeds it one call per dispatched instruction when the build
+// defines DEBUG_PROFILE_OPCODES (cmake -DENABLE_OPCODE_PROFILE=ON); other
+// builds never touch it.
+class OpcodeProfiler {
+public:
+  OpcodeProfiler() { reset(); }
+
+  void instruction(uint8_t opcode) {
+    counts_[opcode]++;
+    if (previous_ != NO_OPCODE) pairs_[previous_][opcode]++;
+
+    if (timing_) {
+      addSample(previous_, readCycles() - start_);
+      timing_ = false;
+    }
+    if (--countdown_ == 0) {
+      countdown_ = OPCODE_PROFILE_SAMPLE_PERIOD;
+      timing_ = true;
+      start_ = readCycles();
+    }
+    previous_ = opcode;
+  }
+
+  // The dispatch loop was left or re-entered: the next instruction neither
+  // pairs with the last one nor ends its sample.
+  void interrupt() {
+    previous_ = NO_OPCODE;
+    timing_ = false;
+  }
+
+  void reset();
+
+  uint64_t getCount(uint8_t opcode) const { return counts_[opcode]; }
+  uint64_t getPairCount(uint8_t first, uint8_t second) const { return pairs_[first][second]; }
+  uint64_t getSampleCount(uint8_t opcode) const { return samples_[opcode]; }
+  uint64_t getTotalCount() const;
+
+  static OpcodeClass classOf(uint8_t opcode);
+  static const char *className(OpcodeClass opcodeClass);
+
+  // Opcodes by count, the most frequent pairs and the class histograms.
+  void writeReport(FILE *out) const;
+  std::string toJson() const;
+
+private:
+  static constexpr uint8_t NO_OPCODE = 0xff;
+  static constexpr size_t TOP_PAIRS = 20;
+
+  static uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    // no TSC: nanoseconds stand in for cycles
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+  }
+
+  void addSample(uint8_t opcode, uint64_t cycles);
+
+  struct Pair {
+    uint8_t first;
+    uint8_t second;
+    uint64_t count;
+  };
+  std::vector<Pair> topPairs() const;
+
+  std::array<uint64_t, OP_COUNT> counts_;
+  std::array<uint64_t, OP_COUNT> samples_;
+  std::array<uint64_t, OP_COUNT> cycles_;
+  std::array<std::array<uint64_t, OP_COUNT>, OP_COUNT> pairs_;
+  std::array<std::array<uint64_t, OPCODE_PROFILE_BUCKETS>, static_cast<size_t>(OpcodeClass::COUNT)> histograms_;
+
+  uint8_t previous_;
+  bool timing_;
+  uint32_t countdown_;
+  uint64_t start_;
+};
+
+#endif // asas_opcode_profiler_h
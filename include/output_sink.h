@@ -0,0 +1,90 @@
+#ifndef asas_output_sink_h
+#define asas_output_sink_h
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+// Buffered destination for everything a script prints. Text is collected in
+// a fixed buffer and handed to writeOut() when the buffer fills up, when
+// flush() is called, or at every newline in line-buffered mode. Embedders
+// pick a subclass (or write their own) and install it with
+// VM::setOutputSink().
+class OutputSink {
+public:
+  explicit OutputSink(size_t capacity = OUTPUT_BUFFER_SIZE)
+      : buffer_(capacity), used_(0), lineBuffered_(false) {}
+  OutputSink(const OutputSink&) = delete;
+  OutputSink& operator=(const OutputSink&) = delete;
+  // subclasses flush in their own destructor, writeOut is gone by now
+  virtual ~OutputSink() = default;
+
+  void write(const char *chars, size_t length);
+  void write(const char *text) { write(text, strlen(text)); }
+  void put(char c) {
+    if (used_ == buffer_.size()) flush();
+    buffer_[used_++] = c;
+    if (lineBuffered_ && c == '\n') flush();
+  }
+  void flush();
+
+  void setLineBuffered(bool lineBuffered) { lineBuffered_ = lineBuffered; }
+  bool isLineBuffered() const { return lineBuffered_; }
+
+protected:
+  virtual void writeOut(const char *chars, size_t length) = 0;
+
+private:
+  std::vector<char> buffer_;
+  size_t used_;
+  bool lineBuffered_;
+};
+
+// Writes to a file descriptor; line buffered when it is a terminal.
+class FdOutputSink : public OutputSink {
+public:
+  explicit FdOutputSink(int fd, size_t capacity = OUTPUT_BUFFER_SIZE);
+  ~FdOutputSink() override { flush(); }
+
+protected:
+  void writeOut(const char *chars, size_t length) override;
+
+private:
+  int fd_;
+};
+
+// Keeps everything in memory, e.g. to capture the output of a job.
+class MemoryOutputSink : public OutputSink {
+public:
+  explicit MemoryOutputSink(size_t capacity = OUTPUT_BUFFER_SIZE) : OutputSink(capacity) {}
+  ~MemoryOutputSink() override { flush(); }
+
+  const std::string &getContents() { flush(); return contents_; }
+  void clear() { flush(); contents_.clear(); }
+
+protected:
+  void writeOut(const char *chars, size_t length) override { contents_.append(chars, length); }
+
+private:
+  std::string contents_;
+};
+
+// Hands every flushed block to a user callback.
+class CallbackOutputSink : public OutputSink {
+public:
+  using Callback = std::function<void(const char *chars, size_t length)>;
+  explicit CallbackOutputSink(Callback callback, size_t capacity = OUTPUT_BUFFER_SIZE)
+      : OutputSink(capacity), callback_(std::move(callback)) {}
+  ~CallbackOutputSink() override { flush(); }
+
+protected:
+  void writeOut(const char *chars, size_t length) override { callback_(chars, length); }
+
+private:
+  Callback callback_;
+};
+
+#endif // asas_output_sink_h
@@ -0,0 +1,116 @@
+#ifndef asas_parallel_marker_h
+#define asas_parallel_marker_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "asas_map.h"
+#include "fiber.h"
+#include "object.h"
+
+// Calls visit(AsasObject*) for every object directly referenced by `object`.
+// Shared by the serial and the parallel mark phases; it only reads the
+// object graph, so it is safe to call from several marker threads at once.
+template<typename Visitor>
+void forEachReference(AsasObject *object, Visitor &&visit) {
+  auto visitValue = [&visit](const Value &value) {
+    if (auto ref = std::get_if<AsasObject*>(&value)) visit(*ref);
+  };
+
+  switch (object->getKind()) {
+  case ObjectKind::FUNCTION: {
+    auto fn = static_cast<AsasFunction*>(object);
+    visit(fn->getAsasStringName());
+    for (const Value &constant : fn->getChunk()->getConstants())
+      visitValue(constant);
+    return;
+  }
+  case ObjectKind::ROPE: {
+    auto rope = static_cast<AsasRope*>(object);
+    visit(rope->getLeft());
+    visit(rope->getRight());
+    visit(rope->getFlat());
+    return;
+  }
+  case ObjectKind::UPVALUE:
+    visitValue(*static_cast<AsasUpvalue*>(object)->getLocation());
+    return;
+  case ObjectKind::CLOSURE: {
+    auto closure = static_cast<AsasClosure*>(object);
+    visit(closure->getFunction());
+    for (AsasUpvalue* upvalue : closure->getUpvalues())
+      visit(upvalue);
+    return;
+  }
+  case ObjectKind::ARRAY:
+    for (const Value &element : static_cast<AsasArray*>(object)->getElements())
+      visitValue(element);
+    return;
+  case ObjectKind::MAP:
+    static_cast<AsasMap*>(object)->forEach([&visitValue](const Value &key, const Value &value) {
+      visitValue(key);
+      visitValue(value);
+    });
+    return;
+  case ObjectKind::FIBER: {
+    auto fiber = static_cast<AsasFiber*>(object);
+    visit(fiber->getClosure());
+    visit(fiber->getCaller());
+    for (const Value &value : fiber->getStack())
+      visitValue(value);
+    for (const CallFrame &frame : fiber->getCallFrames())
+      visit(frame.getClosure());
+    for (auto &[slot, upvalue] : fiber->getOpenUpvalues())
+      visit(upvalue);
+    return;
+  }
+  default:
+    return;
+  }
+}
+
+// Pool of marker threads used by the collector on large heaps. Every worker
+// owns a gray deque: it pushes and pops at the back and, once its own deque
+// runs dry, steals from the front of the others.
+class ParallelMarker {
+public:
+  explicit ParallelMarker(unsigned workerCount);
+  ~ParallelMarker();
+  ParallelMarker(const ParallelMarker&) = delete;
+  ParallelMarker& operator=(const ParallelMarker&) = delete;
+
+  // Traces everything reachable from `grayObjects` (already marked) and
+  // leaves the vector empty. The calling thread takes part as worker 0.
+  void mark(std::vector<AsasObject*> &grayObjects);
+  unsigned getWorkerCount() const { return static_cast<unsigned>(queues_.size()); }
+
+private:
+  struct GrayQueue {
+    std::mutex mutex;
+    std::deque<AsasObject*> objects;
+  };
+
+  void workerLoop(unsigned index);
+  void drain(unsigned index);
+  void pushGray(unsigned index, AsasObject *object);
+  bool popGray(unsigned index, AsasObject *&object);
+  bool stealGray(unsigned thief, AsasObject *&object);
+
+  std::vector<std::unique_ptr<GrayQueue>> queues_;
+  std::vector<std::thread> threads_;
+  // Objects pushed to some deque but not blackened yet; zero means done.
+  std::atomic<size_t> pendingObjects_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable startCondition_;
+  std::condition_variable doneCondition_;
+  unsigned long generation_ = 0;
+  unsigned finishedWorkers_ = 0;
+  bool stopping_ = false;
+};
+
+#endif // asas_parallel_marker_h
@@ -10,8 +10,9 @@ public:
   ParseFn infix;
   Precedence precedence;
 
-  static ParseRule *getRule(TokenType type);
-  static ParseRule rules[TOKEN_COUNT];
+  static const ParseRule *getRule(TokenType type);
+  // read-only, shared by every compiler on every thread
+  static const ParseRule rules[TOKEN_COUNT];
 
 private:
 };
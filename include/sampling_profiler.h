@@ -0,0 +1,103 @@
+#ifndef asas_sampling_profiler_h
+#define asas_sampling_profiler_h
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "call_frame.h"
+
+// Deeper stacks keep their innermost frames and lose the outer ones.
+#define SAMPLE_MAX_DEPTH 64
+// Samples waiting to be folded; a power of two.
+#define SAMPLE_RING_SIZE 256
+#define SAMPLE_DEFAULT_HZ 1000
+
+// Samples the asas call stack and folds the samples into the
+// "frame;frame;frame count" lines read by flamegraph.pl and speedscope.
+//
+// The stack is never read from the signal handler: callFrames_ may be in
+// the middle of a reallocation when SIGPROF lands. The handler (TIMER mode)
+// or an instruction countdown (INSTRUCTIONS mode) only raises a flag, and
+// VM::run() copies the frames at the next dispatch into a single-producer
+// ring buffer. Folding allocates, so it happens later in drain(), which
+// the VM calls when the ring fills up and before every sweep, so the
+// function pointers in pending samples are always alive.
+//
+// TIMER mode uses a process-wide ITIMER_PROF, so only one such profiler
+// can be running at a time.
+class SamplingProfiler {
+public:
+  enum Mode { TIMER, INSTRUCTIONS };
+
+  // TIMER: `rate` samples per second of CPU time.
+  // INSTRUCTIONS: a sample every `rate` dispatched instructions.
+  explicit SamplingProfiler(Mode mode = TIMER, uint32_t rate = SAMPLE_DEFAULT_HZ);
+  SamplingProfiler(const SamplingProfiler&) = delete;
+  SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+  ~SamplingProfiler() { stop(); }
+
+  // false when another TIMER profiler is running or the timer can't be set
+  bool start();
+  void stop();
+
+  // Called by VM::run() before every instruction.
+  bool shouldSample() {
+    if (mode_ == INSTRUCTIONS) {
+      if (--countdown_ != 0) return false;
+      countdown_ = rate_;
+      return true;
+    }
+    return pending_.load(std::memory_order_relaxed) &&
+           pending_.exchange(false, std::memory_order_relaxed);
+  }
+  void capture(const std::vector<CallFrame> &frames);
+
+  // Folds every pending sample. Only on the VM's thread, or while it is
+  // not running.
+  void drain();
+
+  // Lines as `name:line` frames, root first. With lines off a frame is
+  // just the function name, so a function's samples merge into one node.
+  void setIncludeLines(bool includeLines) { includeLines_ = includeLines; }
+  std::string toFolded();
+  void writeFolded(FILE *out);
+
+  uint64_t getSampleCount() const { return sampleCount_; }
+  uint64_t getDroppedCount() const { return droppedCount_; }
+
+private:
+  struct Frame {
+    const AsasFunction *function;
+    int line;
+  };
+  struct Sample {
+    uint32_t depth;
+    std::array<Frame, SAMPLE_MAX_DEPTH> frames; // innermost first
+  };
+
+  static void handleSignal(int);
+  static std::atomic<SamplingProfiler*> timerOwner_;
+
+  Mode mode_;
+  uint32_t rate_;
+  uint32_t countdown_;
+  bool running_ = false;
+  bool includeLines_ = true;
+  std::atomic<bool> pending_ = false;
+
+  // single producer (capture), single consumer (drain)
+  std::unique_ptr<Sample[]> ring_;
+  std::atomic<size_t> head_ = 0; // next slot to write
+  std::atomic<size_t> tail_ = 0; // next slot to fold
+
+  std::map<std::string, uint64_t> folded_;
+  uint64_t sampleCount_ = 0;
+  uint64_t droppedCount_ = 0;
+};
+
+#endif // asas_sampling_profiler_h
@@ -0,0 +1,31 @@
+#ifndef asas_scan_kernels_h
+#define asas_scan_kernels_h
+
+#include "simd_level.h"
+
+// The byte loops of the Scanner: each one takes a position p in the
+// source and its end, and returns where the run it skips ends, at most
+// `end`. The source needs no terminator and may hold NUL bytes, which are
+// ordinary characters here. The vector versions look at 16 (SSE4.2) or 32
+// (AVX2) bytes at a time while a whole block fits before `end` and finish
+// with the scalar loop; scanKernels() picks the widest one the CPU
+// supports the first time it is called. No version reads outside [p, end).
+struct ScanKernels {
+  const char *name;
+  // past ' ', '\t', '\r' and '\n'; adds the newlines to *line
+  const char *(*skipBlanks)(const char *p, const char *end, int *line);
+  // past [A-Za-z0-9_]
+  const char *(*skipIdentifier)(const char *p, const char *end);
+  // past [0-9]
+  const char *(*skipDigits)(const char *p, const char *end);
+  // to the next '"' or `end`; adds the newlines on the way to *line
+  const char *(*findQuote)(const char *p, const char *end, int *line);
+  // to the next '\n' or `end`
+  const char *(*findNewline)(const char *p, const char *end);
+};
+
+const ScanKernels &scanKernels();
+// nullptr when this build or this CPU can't run that level
+const ScanKernels *scanKernelsFor(SimdLevel level);
+
+#endif // asas_scan_kernels_h
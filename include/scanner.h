@@ -1,14 +1,25 @@
 #ifndef asas_scanner_h
 #define asas_scanner_h
 
-#define TOKEN_COUNT 40
+#include "scan_kernels.h"
+#include <cstddef>
+#include <cstring>
+
+#define TOKEN_COUNT 45
+// Runs of blanks, identifier characters, digits and string characters are
+// scanned inline up to this many bytes, where nearly all of them end; the
+// rest of a longer run goes to the vector ScanKernels.
+#define SCAN_INLINE_BYTES 16
 enum TokenType {
   // Single-character tokens.
   TOKEN_LEFT_PAREN,
   TOKEN_RIGHT_PAREN,
   TOKEN_LEFT_BRACE,
   TOKEN_RIGHT_BRACE,
+  TOKEN_LEFT_BRACKET,
+  TOKEN_RIGHT_BRACKET,
   TOKEN_COMMA,
+  TOKEN_COLON,
   TOKEN_DOT,
   TOKEN_MINUS,
   TOKEN_PLUS,
@@ -42,12 +53,14 @@ enum TokenType {
   TOKEN_NIL,
   TOKEN_OR,
   TOKEN_PRINT,
+  TOKEN_RESUME,
   TOKEN_RETURN,
   TOKEN_SUPER,
   TOKEN_THIS,
   TOKEN_TRUE,
   TOKEN_VAR,
   TOKEN_WHILE,
+  TOKEN_YIELD,
 
   // End of file.
   TOKEN_ERROR,
@@ -66,17 +79,33 @@ public:
   int line;
 };
 
+// Scans the `length` bytes at `source`, which need no terminator: a
+// memory-mapped file is scanned in place and the tokens point into it, so
+// the source must outlive them.
 class Scanner {
 public:
-  Scanner(const char *source) : start_(source), current_(source), line_(1) {}
+  Scanner(const char *source, size_t length, const ScanKernels &kernels = scanKernels())
+      : start_(source), current_(source), end_(source + length), line_(1), kernels_(&kernels) {}
+  // a NUL-terminated source
+  explicit Scanner(const char *source, const ScanKernels &kernels = scanKernels())
+      : Scanner(source, strlen(source), kernels) {}
   Token scanToken();
 
-  const char* getRemainingSource() const { return current_; }
+  size_t remaining() const { return static_cast<size_t>(end_ - current_); }
+  // Goes on from `position`, a token boundary of the same source, as if
+  // the scan had reached it on `line`.
+  void seek(const char *position, int line) {
+    start_ = current_ = position;
+    line_ = line;
+  }
 
 private:
   const char *start_;
   const char *current_;
+  const char *end_;
   int line_;
+  // the runs of blanks, identifiers, digits, strings and comments
+  const ScanKernels *kernels_;
 
   Token makeToken(TokenType type);
   Token errorToken(const char *message);
@@ -85,14 +114,15 @@ private:
   Token identifier();
 
   TokenType identifierType();
-  TokenType checkKeyword(int start, int length, const char *rest, TokenType type);
 
   void skipWhitespace();
+  void skipDigits();
 
-  bool isAtEnd() const { return *current_ == '\0'; }
+  bool isAtEnd() const { return current_ == end_; }
 
-  char peek() const { return *current_; }
-  char peekNext() const { return isAtEnd() ? '\0' : *(current_ + 1); }
+  // '\0' past the end; inside the source a NUL is an ordinary character
+  char peek() const { return isAtEnd() ? '\0' : *current_; }
+  char peekNext() const { return end_ - current_ < 2 ? '\0' : current_[1]; }
   char nextChar() { return *current_++; }
   bool match(char expected) {
     if (isAtEnd() || *current_ != expected)
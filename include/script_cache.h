@@ -0,0 +1,54 @@
+#ifndef asas_script_cache_h
+#define asas_script_cache_h
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include "object_fwd.h"
+
+#define SCRIPT_CACHE_CAPACITY 64
+
+// LRU cache of compiled top-level scripts, keyed by a hash of the source
+// text. The full source is kept next to each entry so a hash collision is
+// a miss rather than the wrong script. The owning VM marks every cached
+// function as a GC root; evicted ones are collected like any other object.
+class ScriptCache {
+public:
+  explicit ScriptCache(size_t capacity = SCRIPT_CACHE_CAPACITY) : capacity_(capacity) {}
+
+  AsasFunction *lookup(const char *source, size_t length);
+  void insert(const char *source, size_t length, AsasFunction *function);
+  void clear() { entries_.clear(); index_.clear(); }
+
+  void setCapacity(size_t capacity);
+  size_t getCapacity() const { return capacity_; }
+  size_t size() const { return entries_.size(); }
+  size_t getHits() const { return hits_; }
+  size_t getMisses() const { return misses_; }
+
+  template<typename Fn>
+  void forEachFunction(Fn &&fn) const {
+    for (const Entry &entry : entries_) fn(entry.function);
+  }
+
+  static uint64_t hashSource(const char *source, size_t length);
+
+private:
+  struct Entry {
+    uint64_t hash;
+    std::string source;
+    AsasFunction *function;
+  };
+
+  void evictTo(size_t capacity);
+
+  size_t capacity_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+  // most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+};
+
+#endif // asas_script_cache_h
@@ -0,0 +1,47 @@
+#ifndef asas_script_runner_h
+#define asas_script_runner_h
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "shared_script_registry.h"
+#include "vm.h"
+
+struct ScriptResult {
+  InterpretResult status;
+  std::string output;
+};
+
+// Runs independent scripts on a work-stealing pool. Jobs are dealt out
+// round-robin to per-worker deques; a worker takes from the front of its
+// own deque and, once that is empty, steals from the back of the others.
+// Each worker owns an Isolate and one VM that is reset() between jobs, and
+// scripts are compiled once through a SharedScriptRegistry, so repeating a
+// source costs neither a compile nor a VM setup. `print` output is captured
+// per script; results come back in the order of the sources.
+class ScriptRunner {
+public:
+  // 0 picks one worker per hardware thread
+  explicit ScriptRunner(unsigned workerCount = 0);
+
+  std::vector<ScriptResult> runAll(const std::vector<std::string> &sources);
+  unsigned getWorkerCount() const { return workerCount_; }
+  const SharedScriptRegistry &getRegistry() const { return registry_; }
+
+private:
+  struct JobQueue {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+  };
+
+  bool popJob(unsigned worker, size_t &job);
+  bool stealJob(unsigned thief, size_t &job);
+
+  unsigned workerCount_;
+  std::vector<std::unique_ptr<JobQueue>> queues_;
+  SharedScriptRegistry registry_;
+};
+
+#endif // asas_script_runner_h
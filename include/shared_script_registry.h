@@ -0,0 +1,37 @@
+#ifndef asas_shared_script_registry_h
+#define asas_shared_script_registry_h
+
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "isolate.h"
+#include "object_fwd.h"
+
+// Compiled scripts shared read-only by every VM of a batch run. The
+// registry compiles each distinct source once, on its own isolate, and
+// flags the function and everything reachable from it as shared so worker
+// VMs run the bytecode without tracing or freeing it. Everything is
+// released when the registry goes away, which must be after the last VM
+// that executed one of its scripts.
+class SharedScriptRegistry {
+public:
+  SharedScriptRegistry() = default;
+  SharedScriptRegistry(const SharedScriptRegistry&) = delete;
+  SharedScriptRegistry& operator=(const SharedScriptRegistry&) = delete;
+  ~SharedScriptRegistry();
+
+  // nullptr on a compile error (reported on stderr, not cached)
+  AsasFunction *getOrCompile(const std::string &source);
+  size_t size() const;
+
+private:
+  static void collectObjects(AsasObject *root, std::vector<AsasObject*> &objects);
+
+  Isolate isolate_;
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<std::string, AsasFunction*> scripts_;
+  std::vector<AsasObject*> objects_;
+};
+
+#endif // asas_shared_script_registry_h
@@ -0,0 +1,9 @@
+#ifndef asas_simd_level_h
+#define asas_simd_level_h
+
+// Instruction sets with hand-written kernels (Float64Kernels, ScanKernels).
+// The ...KernelsFor(level) lookups return nullptr for a level the build or
+// the CPU can't run, or that a kernel family has no version for.
+enum class SimdLevel { SCALAR, SSE2, SSE4_2, AVX2 };
+
+#endif // asas_simd_level_h
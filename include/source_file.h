@@ -0,0 +1,36 @@
+#ifndef asas_source_file_h
+#define asas_source_file_h
+
+#include <cstddef>
+#include <string>
+
+// A script file mapped read-only into memory: the Scanner reads it in
+// place, its tokens point into the mapping, and the OS pages the file in
+// as the scan reaches it. Pipes, character devices and empty files can't
+// be mapped and are read into a buffer instead. data() has no terminator.
+//
+// The mapping is private but not a copy: a file truncated by someone else
+// while it is mapped faults on the next access (SIGBUS).
+class SourceFile {
+public:
+  SourceFile() = default;
+  SourceFile(const SourceFile&) = delete;
+  SourceFile& operator=(const SourceFile&) = delete;
+  ~SourceFile() { close(); }
+
+  // false, with `error` set, if `path` can't be opened or read
+  bool open(const std::string &path, std::string &error);
+  void close();
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+  bool isMapped() const { return mapped_; }
+
+private:
+  const char *data_ = "";
+  size_t size_ = 0;
+  bool mapped_ = false;
+  std::string buffer_;
+};
+
+#endif // asas_source_file_h
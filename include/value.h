@@ -20,7 +20,18 @@ public:
   static bool toBool(const Value &value);
 };
 
+// Longest text formatNumber can produce: 309 integer digits for DBL_MAX,
+// sign, point and two decimals.
+#define NUMBER_BUFFER_SIZE 320
+
+// Writes the display form of a number (two decimals, as `print` shows it)
+// into buffer without allocating and returns its length.
+int formatNumber(char *buffer, double number);
+
+class OutputSink;
+
 void printValue(const Value &value);
+void printValue(OutputSink &out, const Value &value);
 void printValue(const char* left, const Value &value, const char* right);
 
 class DataValue {
@@ -29,6 +40,7 @@ public:
   const Value &getAt(size_t index) const { return values_[index]; }
   size_t size() const { return values_.size(); }
   std::vector<Value>& getValues() { return values_; }
+  const std::vector<Value>& getValues() const { return values_; }
 
   // ~DataValue();
   ~DataValue() = default;
@@ -1,16 +1,41 @@
 #ifndef asas_vm_h
 #define asas_vm_h
 
+#include "asas_map.h"
+#include "call_frame.h"
 #include "chunk.h"
 #include "debug.h"
+#include "event_loop.h"
+#include "fiber.h"
+#include "float64_array.h"
+#include "gc_stats.h"
+#include "heap_snapshot.h"
 #include "object.h"
+#include "opcode_profiler.h"
+#include "output_sink.h"
+#include "parallel_marker.h"
+#include "sampling_profiler.h"
+#include "script_cache.h"
+#include "isolate.h"
 #include <algorithm>
 #include <bitset>
+#include <deque>
+#include <memory>
 #include <set>
 #include <stack>
 #include <unordered_map>
 
-#define STACK_MAX 256
+// Heaps with fewer tracked objects than this are marked on a single thread.
+#define GC_PARALLEL_MARK_THRESHOLD 100000
+#define GC_MAX_MARKER_THREADS 32
+// Collections run once the tracked objects outgrow the threshold, which is
+// then reset to GC_HEAP_GROW_FACTOR times what survived.
+#define GC_INITIAL_THRESHOLD 1024
+#define GC_HEAP_GROW_FACTOR 2
+// Concatenations shorter than this are copied eagerly; longer ones build a rope.
+#define ROPE_MIN_LENGTH 64
+// A rope this deep is flattened before anything else is appended to it.
+#define ROPE_MAX_DEPTH 1024
 
 enum InterpretResult {
   INTERPRET_OK,
@@ -18,53 +43,76 @@ enum InterpretResult {
   INTERPRET_RUNTIME_ERROR
 };
 
-class CallFrame {
-public:
-  // CallFrame(AsasFunction *function, size_t slotStartIndex)
-  //     : ip_(function->getChunk()->getCode().data()),
-  //       function_(function), slotStartIndex_(slotStartIndex) { }
-  CallFrame(AsasClosure *closure, size_t slotStartIndex)
-      : ip_(closure->getFunction()->getChunk()->getCode().data()),
-        closure_(closure),
-        function_(closure->getFunction()),
-        slotStartIndex_(static_cast<int>(slotStartIndex)) { }
-
-  const uint8_t readByte() { return *ip_++; }
-  const uint16_t readShort() { return (uint16_t)((readByte() << 8) | readByte()); }
-  const Value readConstant() { return function_->getChunk()->getConstantAt(readByte()); }
-  const void incrementIP(int offset) { ip_ += offset; }
-  const uint8_t getSlot() { return readByte() + slotStartIndex_; }
-  uint8_t getSlotAt(int index) { return slotStartIndex_ + index; }
-  int getSlotStartIndex() const { return slotStartIndex_; }
-  const void debugCF(int frameIndex) {
-    size_t offset = static_cast<size_t>(ip_ - function_->getChunk()->getCode().data());
-    DebugChunk::disassembleInstruction(*function_->getChunk(), offset, frameIndex);
-  }
-  const int getCurrentLine() {
-    size_t offset = static_cast<size_t>(ip_ - function_->getChunk()->getCode().data()) - 1;
-    return function_->getChunk()->getLineAt(offset);
-  }
-  AsasFunction* getFunction() const { return function_; }
-  AsasClosure* getClosure() const { return closure_; }
-
-private:
-  const uint8_t *ip_;
-  AsasClosure *closure_;
-  AsasFunction *function_;
-  const int slotStartIndex_;
-};
-
 class VM {
 public:
-  VM() { 
+  VM() : VM(Isolate::current()) {}
+  // Objects of this VM are accounted to `isolate`, which must outlive it.
+  // The VM makes it current on the calling thread for every call below.
+  explicit VM(Isolate &isolate) : isolate_(isolate), output_(std::make_unique<FdOutputSink>(1)) {
     stack_.reserve(static_cast<size_t>(STACK_MAX));
+    IsolateScope isolateScope(isolate_);
+    defineNativeFunctions();
   }
   InterpretResult interpret(const char *source);
+  // `length` bytes with no terminator, such as a mapped SourceFile
+  InterpretResult interpret(const char *source, size_t length);
   int stackSize() const { return stack_.size(); }
 
+  // Embedding API. compile() returns nullptr on a compile error; compiled
+  // scripts are cached by source, so compiling the same text again is a
+  // lookup. execute() runs a compiled script at top level, callFunction()
+  // calls a global function with arguments from C++. Object values handed
+  // back (results, globals) stay valid until the next call into the VM
+  // unless the script keeps them reachable.
+  AsasFunction* compile(const char *source);
+  AsasFunction* compile(const char *source, size_t length);
+  InterpretResult execute(AsasFunction *script);
+  InterpretResult callFunction(const std::string &name, const std::vector<Value> &args,
+                               Value *result = nullptr);
+  bool getGlobal(const std::string &name, Value &value) const;
+  void setGlobal(const std::string &name, const Value &value) { globals_[name] = value; }
+  // A string owned by this VM, kept alive until reset().
+  Value makeString(const std::string &text);
+  // Drops globals, pinned strings and any half-finished run, then defines
+  // the natives again; compiled scripts stay cached. Memory is reclaimed by the next collection.
+  void reset();
+  ScriptCache &getScriptCache() { return scriptCache_; }
+
+  // Async natives get their arguments and a completion to call, right away
+  // or later from an event loop callback, with the result of the call.
+  // Called from a fiber, the fiber waits while other tasks run; called from
+  // the main script, the VM runs ready tasks and the event loop until the
+  // completion arrives. Defined like a global, so reset() drops them.
+  using Completion = std::function<void(const Value &result)>;
+  using AsyncNativeFn = std::function<void(const std::vector<Value> &args, Completion complete)>;
+  void defineAsyncNative(const char *name, AsyncNativeFn function);
+  EventLoop &getEventLoop();
+
+  void setParallelMarkThreshold(size_t threshold) { parallelMarkThreshold_ = threshold; }
+  ArenaStats getArenaStats() const { return arena_.getStats(); }
+  // Collector counters, with the live totals taken now.
+  GcStats getGcStats() const;
+  // Every tracked object and every GC root, in the V8 .heapsnapshot shape.
+  HeapSnapshot takeHeapSnapshot() const;
+  // Where `print` writes; stdout unless an embedder installs another sink.
+  void setOutputSink(std::unique_ptr<OutputSink> output) {
+    output_->flush();
+    output_ = std::move(output);
+  }
+  OutputSink &getOutputSink() { return *output_; }
+
+  Isolate &getIsolate() const { return isolate_; }
+  // Not owned; the profiler must outlive the VM or be detached with nullptr.
+  void setSamplingProfiler(SamplingProfiler *profiler) { sampler_ = profiler; }
+#ifdef DEBUG_PROFILE_OPCODES
+  OpcodeProfiler &getOpcodeProfiler() { return profiler_; }
+#endif
+
   ~VM() {
+    IsolateScope isolateScope(isolate_);
+    if (sampler_ != nullptr) sampler_->drain();
     for (AsasObject *obj : allocatedObjects_) {
-      delete obj;
+      releaseObject(obj);
       obj = nullptr;
     }
 
@@ -76,10 +124,16 @@ public:
     printf("Asas NativeFunctions remaining after VM destruction: %d\n", AsasNativeFunction::getRefCountObjects());
     printf("Asas Closures remaining after VM destruction: %d\n", AsasClosure::getRefCountObjects());
 
+    ArenaStats arenaStats = arena_.getStats();
+    printf("Arena: %zu slabs, %zu bytes reserved, %zu live, %zu on free lists (%.1f%% fragmented)\n",
+           arenaStats.slabCount, arenaStats.reservedBytes, arenaStats.liveBytes,
+           arenaStats.freeListBytes, arenaStats.fragmentation() * 100.0);
+
     printf("VM destroyed.\n");
 #endif
   }
 private:
+  Isolate &isolate_;
   // Chunk chunk_;
   // const uint8_t *ip_;
   std::vector<Value> stack_;
@@ -89,11 +143,53 @@ private:
   std::vector<CallFrame> callFrames_;
   std::unordered_map<std::string, Value> globals_;
   std::unordered_map<Value*, AsasUpvalue*> openUpvalues_;
+  std::unique_ptr<OutputSink> output_;
+  ScriptCache scriptCache_;
+  std::vector<AsasObject*> pinnedObjects_;
 
-  InterpretResult run();
+  // Runs until the frame count drops back to baseFrameCount; the value
+  // returned by that last frame goes to *returnValue when given.
+  InterpretResult run(size_t baseFrameCount = 0, Value *returnValue = nullptr);
 
   void closeUpValue(Value* value);
   void defineNativeFunctions();
+  void defineNative(const char *name, AsasNativeFunction::NativeFn function);
+
+  // Fibers. The running context is always the one in stack_, callFrames_,
+  // markedFlags_ and openUpvalues_; switching swaps those with the fiber's.
+  void switchContext(AsasFiber *fiber);
+  bool resumeFiber(const Value &target, const Value &value);
+  bool yieldFiber(const Value &value);
+  void finishFiber(const Value &result);
+  void closeDeadFibers();
+  AsasFiber *currentFiber_ = nullptr;
+  // every fiber still alive, so the collector can close the upvalues left
+  // open on the stack of one it is about to free
+  std::vector<AsasFiber*> fibers_;
+
+  // Tasks: fibers run by the VM itself rather than resumed by a script.
+  // Waiting ones go back to readyFibers_ when their completion arrives.
+  struct ReadyFiber {
+    AsasFiber *fiber;
+    Value value;
+  };
+  AsasNativeFunction::NativeFn makeAsyncNative(AsyncNativeFn function);
+  Value callAsync(const AsyncNativeFn &function, const std::vector<Value> &args);
+  void waitFiber();
+  AsasFiber *newFiber(const Value &function, const char *native);
+  InterpretResult runEventLoop(const std::function<bool()> &until = nullptr);
+  InterpretResult runTask(AsasFiber *fiber, const Value &value);
+  // control is back where a nested run() for the event loop started
+  bool backAtBase(size_t baseFrameCount) const {
+    return currentFiber_ == nullptr && callFrames_.size() == baseFrameCount;
+  }
+  std::deque<ReadyFiber> readyFibers_;
+  std::unique_ptr<EventLoop> eventLoop_;
+  bool waitRequested_ = false;
+  // completions meant for the main script, by wait id, kept here so the GC
+  // sees them
+  std::unordered_map<uint64_t, Value> mainResults_;
+  uint64_t nextWaitId_ = 0;
   AsasUpvalue* captureUpvalue(Value* local);
 
   void markSlot(int index) { markedFlags_.set(index); }
@@ -119,6 +215,8 @@ private:
   }
 
   Value runtimeError(const char *format, ...);
+  void resetStack();
+  void abandonTasks();
   void opEqual();
   void opGreater();
   void opLess();
@@ -128,6 +226,19 @@ private:
   void opDivide();
   void opNegate();
   void opNot();
+  void opArray(int count);
+  void opMap(int count);
+  bool mapKey(Value &key);
+  void opGetIndex();
+  void opSetIndex();
+  void opLength();
+  AsasString* concatenate(AsasString *left, const char *right, int rightLength);
+  AsasObject* concatenateStrings(AsasObject *left, AsasObject *right);
+  bool stringsEqual(AsasObject *left, AsasObject *right);
+  AsasString* flatten(AsasRope *rope);
+  static bool isString(AsasObject *object) {
+    return object->getKind() == ObjectKind::STRING || object->getKind() == ObjectKind::ROPE;
+  }
 
   void debugVM();
   bool callValue(const Value &callee, int argCount);
@@ -135,14 +246,36 @@ private:
   bool handleClosureCall(AsasClosure* closure, int argCount);
 
   // garbage collection
+  ObjectArena arena_;
   std::set<AsasObject*> allocatedObjects_;
 
   // template<typename T, typename... Args>
   // template T shoud be derived from AsasObject
   template<typename T, typename... Args>
   T* allocateObject(Args&&... args) {
-    T* object = new T(std::forward<Args>(args)...);
+    uint8_t sizeClass;
+    void* memory = arena_.allocate(sizeof(T), sizeClass);
+    T* object = memory != nullptr
+      ? new (memory) T(std::forward<Args>(args)...)
+      : new T(std::forward<Args>(args)...);
+    object->setSizeClass(sizeClass);
+    return registerObject(object);
+  }
+  // With chars == nullptr the string is left blank for the caller to fill.
+  AsasString* allocateString(const char *chars, int length) {
+    uint8_t sizeClass;
+    void* memory = arena_.allocate(AsasString::allocationSize(length), sizeClass);
+    AsasString* string = memory != nullptr
+      ? AsasString::construct(memory, chars, length)
+      : AsasString::create(chars, length);
+    string->setSizeClass(sizeClass);
+    return registerObject(string);
+  }
+  template<typename T>
+  T* registerObject(T* object) {
     allocatedObjects_.insert(object);
+    gcStats_.objectsAllocated++;
+    chargeObject(object);
 
   #ifdef DEBUG_LOG_GC
     AsasObject* objPtr = reinterpret_cast<AsasObject*>(object);
@@ -156,17 +289,19 @@ private:
     // push(reinterpret_cast<Value>(object));
     // AsasObject* objPtr = reinterpret_cast<AsasObject*>(object);
     push(reinterpret_cast<AsasObject*>(object));
-    // TODO: trigger garbage collection based on some threshold
-    collectGarbage();
-
-
+    maybeCollectGarbage();
     pop();
 
     return object;
   }
   template<typename T>
   T* traceObject(T* object) {
-    allocatedObjects_.insert(object);
+    // owned by a SharedScriptRegistry, not by this VM
+    if (object->isShared()) return object;
+    if (allocatedObjects_.insert(object).second) {
+      gcStats_.objectsAllocated++;
+      chargeObject(object);
+    }
 #ifdef DEBUG_LOG_GC
     AsasObject* objPtr = reinterpret_cast<AsasObject*>(object);
     Value v = objPtr;
@@ -179,18 +314,50 @@ private:
 #endif
 
     push(reinterpret_cast<AsasObject*>(object));
-    collectGarbage();
+    maybeCollectGarbage();
     pop();
     return object;
   }
+  // objects coming from allocateObject live in the arena, the ones the
+  // compiler creates with new are only traced later and go back to delete
+  void releaseObject(AsasObject *object) {
+    uint8_t sizeClass = object->getSizeClass();
+    if (sizeClass == ObjectArena::HEAP_CLASS) return void(delete object);
+    object->~AsasObject();
+    arena_.deallocate(object, sizeClass);
+  }
   void collectGarbage();
+  void maybeCollectGarbage() {
+#ifdef DEBUG_STRESS_GC
+    collectGarbage();
+#else
+    if (allocatedObjects_.size() > nextGC_) collectGarbage();
+#endif
+  }
   void setupGarbageCollector(AsasObject* rootScript);
+  void chargeObject(AsasObject *object) {
+    size_t bytes = objectByteSize(object);
+    object->setChargedBytes(bytes);
+    gcStats_.bytesAllocated += bytes;
+  }
+  void rechargeObject(AsasObject *object);
 
   void markRoots();
   void markValue(Value *value, bool traceObject);
   void markObject(AsasObject *object, bool traceObject);
+  void traceReferences(bool traceObject);
   void freeObjects();
+
+  std::vector<AsasObject*> grayObjects_;
+  size_t nextGC_ = GC_INITIAL_THRESHOLD;
+  size_t parallelMarkThreshold_ = GC_PARALLEL_MARK_THRESHOLD;
+  std::unique_ptr<ParallelMarker> parallelMarker_;
   int instructionCount_ = 0;
+  SamplingProfiler *sampler_ = nullptr;
+  GcStats gcStats_;
+#ifdef DEBUG_PROFILE_OPCODES
+  OpcodeProfiler profiler_;
+#endif
 
 };
 
@@ -8,8 +8,13 @@
 #include "debug.h"
 #include "vm.h"
 #include "compiler.h"
+#include "script_runner.h"
+#include "source_file.h"
 
+// One VM for the whole session: globals and functions defined on earlier
+// lines stay available, and errors only abort the line that caused them.
 static void repl() {
+  VM vm;
   std::string line;
   for (;;) {
     std::cout << "> " << std::flush;
@@ -18,8 +23,7 @@ static void repl() {
       std::cout << "\n";
       break;
     }
-    VM vm;
-    InterpretResult result = vm.interpret(line.c_str());
+    vm.interpret(line.c_str());
   }
 }
 
@@ -36,18 +40,104 @@ static std::string readFile(const std::string &path) {
   return buffer.str();
 }
 
-static void runFile(const std::string &path) {
-  std::string source = readFile(path);
+// "-" prints the report on stderr, anything else is a JSON file
+static void writeOpcodeProfile(VM &vm, const std::string &destination) {
+#ifdef DEBUG_PROFILE_OPCODES
+  OpcodeProfiler &profiler = vm.getOpcodeProfiler();
+  if (destination == "-") return profiler.writeReport(stderr);
+  std::ofstream file(destination);
+  file << profiler.toJson();
+  if (!file) std::cerr << "Could not write \"" << destination << "\".\n";
+#else
+  (void)vm;
+  (void)destination;
+#endif
+}
 
+static void runFile(const std::string &path, const std::string &profilePath,
+                    const std::string &samplePath, bool gcStats,
+                    const std::string &snapshotPath) {
+  // mapped, not copied: the scanner reads the file in place
+  SourceFile source;
+  std::string error;
+  if (!source.open(path, error)) {
+    std::cerr << "Could not open file \"" << path << "\": " << error << ".\n";
+    std::exit(74);
+  }
 
-  // Compiler::compile(source.c_str());
   VM vm;
-  InterpretResult result = vm.interpret(source.c_str());
+  SamplingProfiler sampler;
+  if (!samplePath.empty()) {
+    vm.setSamplingProfiler(&sampler);
+    if (!sampler.start()) std::cerr << "Could not start the sampling profiler.\n";
+  }
+  InterpretResult result = vm.interpret(source.data(), source.size());
+  if (!profilePath.empty()) writeOpcodeProfile(vm, profilePath);
+  if (!samplePath.empty()) {
+    sampler.stop();
+    // folded stacks, for flamegraph.pl or speedscope
+    FILE *out = samplePath == "-" ? stderr : fopen(samplePath.c_str(), "w");
+    if (out == nullptr) {
+      std::cerr << "Could not write \"" << samplePath << "\".\n";
+    } else {
+      sampler.writeFolded(out);
+      if (out != stderr) fclose(out);
+    }
+    vm.setSamplingProfiler(nullptr);
+  }
+  if (gcStats) {
+    std::string json = vm.getGcStats().toJson();
+    fwrite(json.data(), 1, json.size(), stderr);
+  }
+  if (!snapshotPath.empty()) {
+    // load it in Chrome DevTools (Memory tab) or run asas_heap_summary on it
+    std::ofstream file(snapshotPath);
+    file << vm.takeHeapSnapshot().toJson();
+    if (!file) std::cerr << "Could not write \"" << snapshotPath << "\".\n";
+  }
 
   if (result == INTERPRET_COMPILE_ERROR) std::exit(65);
   if (result == INTERPRET_RUNTIME_ERROR) std::exit(70);
 }
 
+// lista de scripts, um caminho por linha; linhas vazias e "#" são ignoradas
+static void readManifest(const std::string &path, std::vector<std::string> &paths) {
+  std::istringstream manifest(readFile(path));
+  std::string line;
+  while (std::getline(manifest, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    paths.push_back(line);
+  }
+}
+
+// Runs every script on a pool of `jobs` workers (0 = one per core) and
+// prints their output in the order given. Exits like runFile with the
+// worst status of the batch.
+static void runBatch(const std::vector<std::string> &paths, unsigned jobs) {
+  std::vector<std::string> sources;
+  sources.reserve(paths.size());
+  for (const std::string &path : paths) sources.push_back(readFile(path));
+
+  ScriptRunner runner(jobs);
+  std::vector<ScriptResult> results = runner.runAll(sources);
+
+  int exitCode = 0;
+  for (const ScriptResult &result : results) {
+    fwrite(result.output.data(), 1, result.output.size(), stdout);
+    if (result.status == INTERPRET_RUNTIME_ERROR) exitCode = std::max(exitCode, 70);
+    if (result.status == INTERPRET_COMPILE_ERROR) exitCode = std::max(exitCode, 65);
+  }
+  fflush(stdout);
+  if (exitCode != 0) std::exit(exitCode);
+}
+
+static void usage() {
+  fprintf(stderr, "Usage: asas [--opcode-profile file|-] [--sample-profile file|-] [--gc-stats]\n"
+                  "            [--heap-snapshot file] [path]\n"
+                  "       asas [--jobs N] [--manifest file] path...\n");
+  exit(64);
+}
+
 int main(int argc, const char *argv[]) {
   // repl();
   // runFile("example/main.as");
@@ -55,13 +145,61 @@ int main(int argc, const char *argv[]) {
   //   repl();
   // else if (argc == 2)
   //   runFile(argv[1]);
-  if (argc == 2)
-     runFile(argv[1]);
-  else {
-    fprintf(stderr, "Usage: asas [path]\n");
-    exit(64);
+  if (argc == 1) {
+    repl();
+    return 0;
   }
 
+  std::vector<std::string> paths;
+  unsigned jobs = 0;
+  bool batch = false;
+  std::string profilePath;
+  std::string samplePath;
+  bool gcStats = false;
+  std::string snapshotPath;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--jobs" || arg == "-j") {
+      if (++i == argc) usage();
+      char *end;
+      long value = strtol(argv[i], &end, 10);
+      if (*end != '\0' || value < 0) usage();
+      jobs = static_cast<unsigned>(value);
+      batch = true;
+    } else if (arg == "--manifest") {
+      if (++i == argc) usage();
+      readManifest(argv[i], paths);
+      batch = true;
+    } else if (arg == "--opcode-profile") {
+      if (++i == argc) usage();
+#ifndef DEBUG_PROFILE_OPCODES
+      fprintf(stderr, "--opcode-profile needs a build with -DENABLE_OPCODE_PROFILE=ON.\n");
+      exit(64);
+#endif
+      profilePath = argv[i];
+    } else if (arg == "--sample-profile") {
+      if (++i == argc) usage();
+      samplePath = argv[i];
+    } else if (arg == "--gc-stats") {
+      gcStats = true;
+    } else if (arg == "--heap-snapshot") {
+      if (++i == argc) usage();
+      snapshotPath = argv[i];
+    } else if (arg.rfind("-", 0) == 0) {
+      usage();
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (paths.empty()) usage();
+  if (!batch && paths.size() == 1)
+    runFile(paths[0], profilePath, samplePath, gcStats, snapshotPath);
+  else if (!profilePath.empty() || !samplePath.empty() || gcStats || !snapshotPath.empty())
+    usage(); // the profile covers a single script
+  else
+    runBatch(paths, jobs);
+
   // runFile("../example/main.txt");
   // if(argc == 1) repl();
   // else if(argc == 2) runFile(argv[1]);
@@ -0,0 +1,177 @@
+#include "asas_map.h"
+#include <bit>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Bit i is set when control byte i of the group equals `byte`.
+static uint32_t matchByte(const int8_t *group, int8_t byte) {
+#ifdef __SSE2__
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(byte))));
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < MAP_GROUP_SIZE; i++)
+    if (group[i] == byte) mask |= 1u << i;
+  return mask;
+#endif
+}
+
+// EMPTY and DELETED are the only negative control bytes, so the sign bits
+// are the free slots.
+static uint32_t matchFree(const int8_t *group) {
+#ifdef __SSE2__
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < MAP_GROUP_SIZE; i++)
+    if (group[i] < 0) mask |= 1u << i;
+  return mask;
+#endif
+}
+
+static uint64_t mix(uint64_t x) {
+  // murmur3 finalizer
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+uint64_t AsasMap::hashValue(const Value &key) {
+  return std::visit([](auto &&v) -> uint64_t {
+    using V = std::decay_t<decltype(v)>;
+    if constexpr (std::is_same_v<V, std::monostate>)
+      return mix(0x9e3779b97f4a7c15ull);
+    else if constexpr (std::is_same_v<V, bool>)
+      return mix(v ? 2 : 1);
+    else if constexpr (std::is_same_v<V, double>) {
+      // 0.0 and -0.0 are equal keys
+      double number = v == 0 ? 0.0 : v;
+      return mix(std::bit_cast<uint64_t>(number));
+    }
+    else {
+      if (auto string = dynamic_cast<const AsasString*>(v)) return mix(string->getHash());
+      return mix(reinterpret_cast<uintptr_t>(v));
+    }
+  }, key);
+}
+
+bool AsasMap::keysEqual(const Value &a, const Value &b) {
+  if (a.index() != b.index()) return false;
+  if (auto left = std::get_if<AsasObject*>(&a)) {
+    AsasObject *right = std::get<AsasObject*>(b);
+    if (*left == right) return true;
+    auto leftString = dynamic_cast<const AsasString*>(*left);
+    auto rightString = dynamic_cast<const AsasString*>(right);
+    return leftString != nullptr && rightString != nullptr &&
+           leftString->getLength() == rightString->getLength() &&
+           leftString->getHash() == rightString->getHash() &&
+           memcmp(leftString->getData(), rightString->getData(), leftString->getLength()) == 0;
+  }
+  return a == b;
+}
+
+// Groups are visited in triangular order (g, g+1, g+3, g+6, ...), which
+// reaches every group of a power-of-two table. A group with an EMPTY slot
+// ends the search, because an insert would have stopped there.
+size_t AsasMap::find(const Value &key, uint64_t hash) const {
+  if (capacity_ == 0) return NOT_FOUND;
+  size_t groupMask = capacity_ / MAP_GROUP_SIZE - 1;
+  size_t group = (hash >> 7) & groupMask;
+  int8_t h2 = static_cast<int8_t>(hash & 0x7f);
+
+  for (size_t step = 0; step <= groupMask; ) {
+    const int8_t *ctrl = ctrl_.get() + group * MAP_GROUP_SIZE;
+    for (uint32_t match = matchByte(ctrl, h2); match != 0; match &= match - 1) {
+      size_t index = group * MAP_GROUP_SIZE + std::countr_zero(match);
+      if (keysEqual(slots_[index].key, key)) return index;
+    }
+    if (matchByte(ctrl, MAP_CTRL_EMPTY) != 0) return NOT_FOUND;
+    group = (group + ++step) & groupMask;
+  }
+  return NOT_FOUND;
+}
+
+size_t AsasMap::findFreeSlot(uint64_t hash) const {
+  size_t groupMask = capacity_ / MAP_GROUP_SIZE - 1;
+  size_t group = (hash >> 7) & groupMask;
+  for (size_t step = 0; ; ) {
+    uint32_t free = matchFree(ctrl_.get() + group * MAP_GROUP_SIZE);
+    if (free != 0) return group * MAP_GROUP_SIZE + std::countr_zero(free);
+    group = (group + ++step) & groupMask;
+  }
+}
+
+bool AsasMap::get(const Value &key, Value &value) const {
+  size_t index = find(key, hashValue(key));
+  if (index == NOT_FOUND) return false;
+  value = slots_[index].value;
+  return true;
+}
+
+bool AsasMap::set(const Value &key, const Value &value) {
+  uint64_t hash = hashValue(key);
+  size_t index = find(key, hash);
+  if (index != NOT_FOUND) {
+    slots_[index].value = value;
+    return false;
+  }
+
+  if ((used_ + tombstones_ + 1) * 8 > capacity_ * 7) {
+    // when the live entries alone would fit at half the maximum load, the
+    // table is full of tombstones: clean up in place instead of growing
+    size_t newCapacity = capacity_ == 0 ? MAP_GROUP_SIZE
+                       : used_ * 16 <= capacity_ * 7 ? capacity_ : capacity_ * 2;
+    rehash(newCapacity);
+  }
+
+  index = findFreeSlot(hash);
+  if (ctrl_[index] == MAP_CTRL_DELETED) tombstones_--;
+  ctrl_[index] = static_cast<int8_t>(hash & 0x7f);
+  slots_[index] = Slot{key, value};
+  used_++;
+  return true;
+}
+
+bool AsasMap::remove(const Value &key) {
+  size_t index = find(key, hashValue(key));
+  if (index == NOT_FOUND) return false;
+
+  // A group that still has an EMPTY slot never made a probe move on, so
+  // the slot can go back to EMPTY; otherwise lookups must keep walking.
+  const int8_t *group = ctrl_.get() + index / MAP_GROUP_SIZE * MAP_GROUP_SIZE;
+  if (matchByte(group, MAP_CTRL_EMPTY) != 0) {
+    ctrl_[index] = MAP_CTRL_EMPTY;
+  } else {
+    ctrl_[index] = MAP_CTRL_DELETED;
+    tombstones_++;
+  }
+  slots_[index] = Slot{};
+  used_--;
+  return true;
+}
+
+void AsasMap::rehash(size_t newCapacity) {
+  std::unique_ptr<int8_t[]> oldCtrl = std::move(ctrl_);
+  std::unique_ptr<Slot[]> oldSlots = std::move(slots_);
+  size_t oldCapacity = capacity_;
+
+  ctrl_ = std::make_unique<int8_t[]>(newCapacity);
+  memset(ctrl_.get(), MAP_CTRL_EMPTY, newCapacity);
+  slots_ = std::make_unique<Slot[]>(newCapacity);
+  capacity_ = newCapacity;
+  tombstones_ = 0;
+
+  for (size_t i = 0; i < oldCapacity; i++) {
+    if (oldCtrl[i] < 0) continue;
+    uint64_t hash = hashValue(oldSlots[i].key);
+    size_t index = findFreeSlot(hash);
+    ctrl_[index] = static_cast<int8_t>(hash & 0x7f);
+    slots_[index] = std::move(oldSlots[i]);
+  }
+}
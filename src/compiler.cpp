@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cstdint>
 #include <cstdlib>
+#include <thread>
 #include "chunk.h"
 #include "stdio.h"
 
@@ -10,12 +14,37 @@
 #include "common.h"
 
 
+Compiler::Compiler(std::unique_ptr<CompileSession> ownSession, Compiler *enclosing,
+                   AsasString *fnName, FunctionType type)
+    : ownSession_(std::move(ownSession)),
+      session_(ownSession_ ? *ownSession_ : enclosing->session_),
+      parser_(session_.parser), scanner_(session_.scanner), enclosing_(enclosing),
+      currentFunction_(new AsasFunction(fnName)), upvalues_(&session_.arena),
+      currentFunctionType_(type), locals_(&session_.arena), nameConstants_(&session_.arena)
+{
+  session_.created.push_back(currentFunction_);
+  Token token(TOKEN_FUNC, "func_main", 0, 0);
+  locals_.push_back(LocalVariable(token, 0));
+}
+
+CompileSession::~CompileSession() {
+  for (PrecompiledFunction &part : precompiled)
+    for (AsasObject *object : part.objects) delete object;
+}
+
 AsasFunction *Compiler::compile() {
+  if (enclosing_ == nullptr && scanner_.remaining() >= parallelThreshold_)
+    precompileFunctions();
   advance();
   while (!match(TOKEN_EOF)) {
     declaration();
   }
-  return parser_.hadError ? nullptr : endCompiler();
+  if (!parser_.hadError) return endCompiler();
+
+  // nothing else references them yet
+  for (AsasObject *object : session_.created) delete object;
+  session_.created.clear();
+  return nullptr;
 }
 
 void Compiler::declaration() {
@@ -29,15 +58,116 @@ void Compiler::declaration() {
 void Compiler::functionDeclaration() {
   uint8_t global = parseVariable("Expect function name.");
   markInitialized();
-  function(FunctionType::FUNCTION);
+  if (!linkPrecompiled()) function(FunctionType::FUNCTION);
   defineVariable(global);
 }
 
+// The pre-scan: at brace depth 0, `func name` opens a function and the
+// brace that brings the depth back to 0 closes it. Anything it gets wrong
+// fails to compile on the worker and is left to the sequential path.
+void Compiler::precompileFunctions() {
+  unsigned threads = parallelThreads_ != 0
+      ? parallelThreads_
+      : std::min<unsigned>(std::thread::hardware_concurrency(), COMPILER_MAX_THREADS);
+  // one thread would only add the pre-scan
+  if (threads < 2) return;
+
+  Scanner scanner = scanner_;
+  std::vector<PrecompiledFunction> &parts = session_.precompiled;
+  PrecompiledFunction part;
+  bool open = false;
+  int depth = 0;
+  TokenType before = TOKEN_EOF;
+  for (Token token = scanner.scanToken(); token.type != TOKEN_EOF; token = scanner.scanToken()) {
+    if (token.type == TOKEN_LEFT_BRACE) {
+      depth++;
+    } else if (token.type == TOKEN_RIGHT_BRACE) {
+      // unbalanced, leave it all to the sequential compile
+      if (--depth < 0) return parts.clear();
+      if (depth == 0 && open) {
+        part.end = token.start + 1;
+        part.endLine = token.line;
+        parts.push_back(part);
+        open = false;
+      }
+    } else if (depth == 0 && before == TOKEN_FUNC && token.type == TOKEN_IDENTIFIER) {
+      part.name = token;
+      open = true;
+    }
+    before = token.type;
+  }
+  if (parts.size() < 2) return parts.clear();
+
+  threads = static_cast<unsigned>(std::min<size_t>(threads, parts.size()));
+  // the objects count against the isolate of the compile
+  Isolate &isolate = Isolate::current();
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    IsolateScope isolateScope(isolate);
+    for (size_t i = next++; i < parts.size(); i = next++) precompile(scanner_, parts[i]);
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (unsigned i = 1; i < threads; i++) workers.emplace_back(work);
+  work();
+  for (std::thread &worker : workers) worker.join();
+}
+
+// Compiles `part` the way function() does when the script gets there: as
+// the only declaration of a script of its own, read on from its name. It
+// only links if it compiled cleanly up to its closing brace and captured
+// nothing, so the script chunk of that compile is OP_CLOSURE alone.
+void Compiler::precompile(const Scanner &scanner, PrecompiledFunction &part) {
+  auto ownSession = std::make_unique<CompileSession>(scanner);
+  CompileSession &session = *ownSession;
+  session.scanner.seek(part.name.start, part.name.line);
+  session.reportErrors = false;
+  AsasString *scriptName = AsasString::create("<script>", 8);
+  Compiler script(std::move(ownSession), nullptr, scriptName, FunctionType::SCRIPT);
+  script.advance();
+  script.advance();
+  script.function(FunctionType::FUNCTION);
+
+  const Chunk *chunk = script.currentChunk();
+  bool linkable = !session.parser.hadError && session.parser.previous.type == TOKEN_RIGHT_BRACE &&
+                  session.parser.previous.start + 1 == part.end && chunk->getCode().size() == 2;
+  // created[0] is the script's own function
+  if (linkable) {
+    part.function = static_cast<AsasFunction*>(std::get<AsasObject*>(chunk->getConstantAt(0)));
+    part.objects.assign(session.created.begin() + 1, session.created.end());
+  } else {
+    for (size_t i = 1; i < session.created.size(); i++) delete session.created[i];
+  }
+  delete session.created[0];
+  delete scriptName;
+  session.created.clear();
+}
+
+// With the function's name just consumed: if a worker compiled it, emit
+// its closure and go on past its closing brace, leaving the parser where
+// function() would.
+bool Compiler::linkPrecompiled() {
+  std::vector<PrecompiledFunction> &parts = session_.precompiled;
+  if (parts.empty() || enclosing_ != nullptr || scopeDepth_ != 0) return false;
+  size_t &next = session_.nextPrecompiled;
+  while (next < parts.size() && parts[next].name.start < parser_.previous.start) next++;
+  if (next == parts.size() || parts[next].name.start != parser_.previous.start) return false;
+  PrecompiledFunction &part = parts[next++];
+  if (part.function == nullptr) return false;
+
+  scanner_.seek(part.end, part.endLine);
+  parser_.current = Token(TOKEN_RIGHT_BRACE, part.end - 1, 1, part.endLine);
+  advance();
+  emitBytes(OP_CLOSURE, makeConstant(part.function));
+  session_.created.insert(session_.created.end(), part.objects.begin(), part.objects.end());
+  part.objects.clear();
+  return true;
+}
+
 void Compiler::function(FunctionType type) {
-  AsasString* functionName = new AsasString(parser_.previous.start, parser_.previous.length);
-  Compiler functionCompiler(scanner_.getRemainingSource(), functionName, type);
-  functionCompiler.parser_ = parser_;
-  functionCompiler.enclosing_ = this;
+  AsasString* functionName = newString(parser_.previous.start, parser_.previous.length);
+  // reads on from the same scanner and parser
+  Compiler functionCompiler(nullptr, this, functionName, type);
   
   functionCompiler.beginScope();
   functionCompiler.consume(TOKEN_LEFT_PAREN, "Expect '(' after function name.");
@@ -65,9 +195,6 @@ void Compiler::function(FunctionType type) {
     emitByte(upvalue.isLocal);
     emitByte(upvalue.index);
   }
-
-  parser_ = functionCompiler.parser_;
-  scanner_ = functionCompiler.scanner_;
 }
 
 void Compiler::varDeclaration() {
@@ -145,7 +272,13 @@ void Compiler::addLocal(const Token &name) {
 };
 
 uint8_t Compiler::identifierConstant(const Token &name) {
-  return makeConstant(new AsasString(name.start, name.length));
+  // the name points into the source, which outlives the compile
+  std::string_view text(name.start, name.length);
+  auto found = nameConstants_.find(text);
+  if (found != nameConstants_.end()) return found->second;
+  uint8_t constant = makeConstant(newString(name.start, name.length));
+  nameConstants_.emplace(text, constant);
+  return constant;
 }
 
 void Compiler::markInitialized() {
@@ -299,6 +432,60 @@ void Compiler::call(bool) {
   emitBytes(OP_CALL, argCount);
 }
 
+void Compiler::arrayLiteral(bool) {
+  int count = 0;
+  if (!check(TOKEN_RIGHT_BRACKET)) {
+    do {
+      if (check(TOKEN_RIGHT_BRACKET)) break; // trailing comma
+      expression();
+      if (count == 255) error("Can't have more than 255 elements in an array literal.");
+      count++;
+    } while (match(TOKEN_COMMA));
+  }
+  consume(TOKEN_RIGHT_BRACKET, "Expect ']' after array elements.");
+  emitBytes(OP_ARRAY, static_cast<uint8_t>(count));
+}
+
+// {key: value, ...} -- only in expression position, a '{' that starts a
+// statement is still a block.
+void Compiler::mapLiteral(bool) {
+  int count = 0;
+  if (!check(TOKEN_RIGHT_BRACE)) {
+    do {
+      if (check(TOKEN_RIGHT_BRACE)) break; // trailing comma
+      expression();
+      consume(TOKEN_COLON, "Expect ':' after map key.");
+      expression();
+      if (count == 255) error("Can't have more than 255 entries in a map literal.");
+      count++;
+    } while (match(TOKEN_COMMA));
+  }
+  consume(TOKEN_RIGHT_BRACE, "Expect '}' after map entries.");
+  emitBytes(OP_MAP, static_cast<uint8_t>(count));
+}
+
+void Compiler::index(bool canAssign) {
+  expression();
+  consume(TOKEN_RIGHT_BRACKET, "Expect ']' after index.");
+
+  if (canAssign && match(TOKEN_EQUAL)) {
+    expression();
+    emitByte(OP_SET_INDEX);
+  } else {
+    emitByte(OP_GET_INDEX);
+  }
+}
+
+void Compiler::dot(bool) {
+  consume(TOKEN_IDENTIFIER, "Expect property name after '.'.");
+  const Token &name = parser_.previous;
+  if (name.length == 6 && memcmp(name.start, "length", 6) == 0) {
+    emitByte(OP_LENGTH);
+    return;
+  }
+  error("Unknown property, only 'length' is supported.");
+}
+
 uint8_t Compiler::argumentsList() {
   uint8_t argCount = 0;
   if (!check(TOKEN_RIGHT_PAREN)) {
@@ -384,7 +571,7 @@ int Compiler::resolveLocal(const Token &name) {
 
 void Compiler::string(bool) {
   // Trim the surrounding quotes.
-  AsasString* stringObj = new AsasString(parser_.previous.start + 1, parser_.previous.length - 2);
+  AsasString* stringObj = newString(parser_.previous.start + 1, parser_.previous.length - 2);
   emitConstant(stringObj);
 }
 
@@ -398,7 +585,9 @@ void Compiler::literal(bool) {
 }
 
 void Compiler::number(bool) {
-  double value = strtod(parser_.previous.start, nullptr);
+  // the token may end the source, with no terminator after it
+  double value = 0;
+  std::from_chars(parser_.previous.start, parser_.previous.start + parser_.previous.length, value);
   emitBytes(OP_CONSTANT, currentChunk()->addConstant(value));
 }
 
@@ -436,6 +625,28 @@ void Compiler::orOperator(bool) {
   patchJump(endJump);
 }
 
+// yield [value] -- suspends the running fiber; evaluates to whatever the
+// next resume passes in.
+void Compiler::yieldExpression(bool) {
+  if (check(TOKEN_SEMICOLON) || check(TOKEN_RIGHT_PAREN) || check(TOKEN_COMMA) ||
+      check(TOKEN_RIGHT_BRACE) || check(TOKEN_EOF))
+    emitByte(OP_NIL);
+  else
+    parsePrecedence(PREC_ASSIGNMENT);
+  emitByte(OP_YIELD);
+}
+
+// resume(fiber [, value]) -- runs the fiber until its next yield or its
+// return and evaluates to the value yielded or returned.
+void Compiler::resumeExpression(bool) {
+  consume(TOKEN_LEFT_PAREN, "Expect '(' after 'resume'.");
+  expression();
+  if (match(TOKEN_COMMA)) expression();
+  else emitByte(OP_NIL);
+  consume(TOKEN_RIGHT_PAREN, "Expect ')' after resume arguments.");
+  emitByte(OP_RESUME);
+}
+
 void Compiler::unary(bool) {
   TokenType operatorType = parser_.previous.type;
 
@@ -452,7 +663,7 @@ void Compiler::unary(bool) {
 
 void Compiler::binary(bool) {
   TokenType operatorType = parser_.previous.type;
-  ParseRule *rule = ParseRule::getRule(operatorType);
+  const ParseRule *rule = ParseRule::getRule(operatorType);
   parsePrecedence((Precedence)(rule->precedence + 1));
 
   switch (operatorType) {
@@ -485,6 +696,7 @@ void Compiler::errorAt(const Token &token, const char *message) {
   if (parser_.panicMode) return;
   parser_.panicMode = true;
   parser_.hadError = true;
+  if (!session_.reportErrors) return;
   fprintf(stderr, "[line %d] Error", token.line);
 
   if (token.type == TOKEN_EOF) fprintf(stderr, " at end");
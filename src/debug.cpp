@@ -75,6 +75,13 @@ int DebugChunk::disassembleInstruction_(const Chunk &chunk, int offset) {
     return offset + 2 + function->getUpvalueCount() * 2;
   }
   case OP_CLOSE_UPVALUE: return DebugChunk::simpleInstruction("OP_CLOSE_UPVALUE", offset);
+  case OP_ARRAY: return DebugChunk::byteInstruction("OP_ARRAY", chunk, offset);
+  case OP_MAP: return DebugChunk::byteInstruction("OP_MAP", chunk, offset);
+  case OP_GET_INDEX: return DebugChunk::simpleInstruction("OP_GET_INDEX", offset);
+  case OP_SET_INDEX: return DebugChunk::simpleInstruction("OP_SET_INDEX", offset);
+  case OP_LENGTH: return DebugChunk::simpleInstruction("OP_LENGTH", offset);
+  case OP_YIELD: return DebugChunk::simpleInstruction("OP_YIELD", offset);
+  case OP_RESUME: return DebugChunk::simpleInstruction("OP_RESUME", offset);
   case OP_RETURN: return DebugChunk::simpleInstruction("OP_RETURN", offset);
   default:
     printf("Unknown opcode %d\n", instruction);
@@ -82,6 +89,20 @@ int DebugChunk::disassembleInstruction_(const Chunk &chunk, int offset) {
   }
 }
 
+const char *DebugChunk::opcodeName(uint8_t opcode) {
+  static const char *names[] = {
+    "OP_CONSTANT", "OP_NIL", "OP_TRUE", "OP_FALSE", "OP_POP", "OP_POP_UNTIL",
+    "OP_DEFINE_GLOBAL", "OP_GET_GLOBAL", "OP_SET_GLOBAL", "OP_GET_UPVALUE",
+    "OP_SET_UPVALUE", "OP_GET_LOCAL", "OP_SET_LOCAL", "OP_EQUAL", "OP_GREATER",
+    "OP_LESS", "OP_ADD", "OP_SUBTRACT", "OP_MULTIPLY", "OP_DIVIDE", "OP_NOT",
+    "OP_NEGATE", "OP_PRINT", "OP_JUMP", "OP_JUMP_IF_FALSE", "OP_LOOP", "OP_CALL",
+    "OP_CLOSURE", "OP_CLOSE_UPVALUE", "OP_ARRAY", "OP_MAP", "OP_GET_INDEX",
+    "OP_SET_INDEX", "OP_LENGTH", "OP_YIELD", "OP_RESUME", "OP_RETURN",
+  };
+  static_assert(sizeof(names) / sizeof(names[0]) == OP_COUNT, "one name per opcode");
+  return opcode < OP_COUNT ? names[opcode] : "OP_UNKNOWN";
+}
+
 int DebugChunk::simpleInstruction(const char *name, int offset) {
   printf("%s\n", name);
   return offset + 1;
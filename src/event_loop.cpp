@@ -0,0 +1,110 @@
+#include "event_loop.h"
+#include <cerrno>
+#include <ctime>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define EVENT_BATCH_SIZE 64
+
+static uint64_t monotonicNow() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+EventLoop::EventLoop()
+    : epollFd_(epoll_create1(EPOLL_CLOEXEC)),
+      timerFd_(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) {
+  if (epollFd_ < 0 || timerFd_ < 0) throw std::runtime_error("Could not create the event loop.");
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = timerFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, timerFd_, &event);
+}
+
+EventLoop::~EventLoop() {
+  close(timerFd_);
+  close(epollFd_);
+}
+
+void EventLoop::addTimer(double seconds, Callback callback) {
+  uint64_t delay = seconds > 0 ? static_cast<uint64_t>(seconds * 1e9) : 0;
+  uint64_t deadline = monotonicNow() + delay;
+  bool earliest = timers_.empty() || deadline < timers_.top().deadline;
+  timers_.push(Timer{deadline, timerSequence_++, std::move(callback)});
+  if (earliest) armTimer();
+}
+
+bool EventLoop::watchReadable(int fd, Callback callback) {
+  return watch(fd, EPOLLIN, std::move(callback));
+}
+
+bool EventLoop::watchWritable(int fd, Callback callback) {
+  return watch(fd, EPOLLOUT, std::move(callback));
+}
+
+bool EventLoop::watch(int fd, uint32_t events, Callback callback) {
+  if (watches_.contains(fd)) return false;
+  epoll_event event{};
+  event.events = events | EPOLLONESHOT;
+  event.data.fd = fd;
+  if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0) return false;
+  watches_.emplace(fd, std::move(callback));
+  return true;
+}
+
+size_t EventLoop::runOnce(int timeoutMs) {
+  epoll_event events[EVENT_BATCH_SIZE];
+  int count;
+  do {
+    count = epoll_wait(epollFd_, events, EVENT_BATCH_SIZE, timeoutMs);
+  } while (count < 0 && errno == EINTR);
+
+  size_t ran = 0;
+  for (int i = 0; i < count; i++) {
+    int fd = events[i].data.fd;
+    if (fd == timerFd_) {
+      uint64_t expirations;
+      while (read(timerFd_, &expirations, sizeof(expirations)) > 0) {}
+      ran += runDueTimers();
+      continue;
+    }
+
+    auto watched = watches_.find(fd);
+    if (watched == watches_.end()) continue;
+    Callback callback = std::move(watched->second);
+    watches_.erase(watched);
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    callback();
+    ran++;
+  }
+  return ran;
+}
+
+// Callbacks may add timers, so the due ones are taken off the heap first.
+size_t EventLoop::runDueTimers() {
+  uint64_t now = monotonicNow();
+  std::vector<Callback> due;
+  while (!timers_.empty() && timers_.top().deadline <= now) {
+    due.push_back(std::move(const_cast<Timer&>(timers_.top()).callback));
+    timers_.pop();
+  }
+  armTimer();
+  for (Callback &callback : due) callback();
+  return due.size();
+}
+
+void EventLoop::armTimer() {
+  itimerspec spec{};
+  if (!timers_.empty()) {
+    uint64_t now = monotonicNow();
+    uint64_t deadline = timers_.top().deadline;
+    // an already expired timer still needs a non-zero value to fire
+    uint64_t delay = deadline > now ? deadline - now : 1;
+    spec.it_value.tv_sec = static_cast<time_t>(delay / 1000000000ull);
+    spec.it_value.tv_nsec = static_cast<long>(delay % 1000000000ull);
+  }
+  timerfd_settime(timerFd_, 0, &spec, nullptr);
+}
@@ -0,0 +1,238 @@
+#include "float64_array.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ASAS_X86 1
+#endif
+
+// Scalar versions: the fallback, and the tail loop of the vector ones.
+
+static double scalarSum(const double *values, size_t count) {
+  double total = 0;
+  for (size_t i = 0; i < count; i++) total += values[i];
+  return total;
+}
+
+static double scalarDot(const double *left, const double *right, size_t count) {
+  double total = 0;
+  for (size_t i = 0; i < count; i++) total += left[i] * right[i];
+  return total;
+}
+
+static void scalarScale(double *values, size_t count, double factor) {
+  for (size_t i = 0; i < count; i++) values[i] *= factor;
+}
+
+static void scalarAdd(double *left, const double *right, size_t count) {
+  for (size_t i = 0; i < count; i++) left[i] += right[i];
+}
+
+static double scalarMin(const double *values, size_t count) {
+  double result = values[0];
+  for (size_t i = 1; i < count; i++) result = values[i] < result ? values[i] : result;
+  return result;
+}
+
+static double scalarMax(const double *values, size_t count) {
+  double result = values[0];
+  for (size_t i = 1; i < count; i++) result = values[i] > result ? values[i] : result;
+  return result;
+}
+
+static void scalarPrefixSum(double *values, size_t count) {
+  for (size_t i = 1; i < count; i++) values[i] += values[i - 1];
+}
+
+static const Float64Kernels SCALAR_KERNELS = {
+  "scalar", scalarSum, scalarDot, scalarScale, scalarAdd, scalarMin, scalarMax, scalarPrefixSum,
+};
+
+#ifdef ASAS_X86
+
+// SSE2 is part of x86-64, so these need no feature check there.
+
+static double horizontalSum(__m128d v) {
+  return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static double sse2Sum(const double *values, size_t count) {
+  // two accumulators hide the latency of the adds
+  __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    a = _mm_add_pd(a, _mm_loadu_pd(values + i));
+    b = _mm_add_pd(b, _mm_loadu_pd(values + i + 2));
+  }
+  return horizontalSum(_mm_add_pd(a, b)) + scalarSum(values + i, count - i);
+}
+
+static double sse2Dot(const double *left, const double *right, size_t count) {
+  __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    a = _mm_add_pd(a, _mm_mul_pd(_mm_loadu_pd(left + i), _mm_loadu_pd(right + i)));
+    b = _mm_add_pd(b, _mm_mul_pd(_mm_loadu_pd(left + i + 2), _mm_loadu_pd(right + i + 2)));
+  }
+  return horizontalSum(_mm_add_pd(a, b)) + scalarDot(left + i, right + i, count - i);
+}
+
+static void sse2Scale(double *values, size_t count, double factor) {
+  __m128d f = _mm_set1_pd(factor);
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2)
+    _mm_storeu_pd(values + i, _mm_mul_pd(_mm_loadu_pd(values + i), f));
+  scalarScale(values + i, count - i, factor);
+}
+
+static void sse2Add(double *left, const double *right, size_t count) {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2)
+    _mm_storeu_pd(left + i, _mm_add_pd(_mm_loadu_pd(left + i), _mm_loadu_pd(right + i)));
+  scalarAdd(left + i, right + i, count - i);
+}
+
+static double sse2Min(const double *values, size_t count) {
+  if (count < 2) return scalarMin(values, count);
+  __m128d m = _mm_loadu_pd(values);
+  size_t i = 2;
+  for (; i + 2 <= count; i += 2) m = _mm_min_pd(m, _mm_loadu_pd(values + i));
+  m = _mm_min_sd(m, _mm_unpackhi_pd(m, m));
+  double result = _mm_cvtsd_f64(m);
+  // at most one element is left over
+  return i < count && values[i] < result ? values[i] : result;
+}
+
+static double sse2Max(const double *values, size_t count) {
+  if (count < 2) return scalarMax(values, count);
+  __m128d m = _mm_loadu_pd(values);
+  size_t i = 2;
+  for (; i + 2 <= count; i += 2) m = _mm_max_pd(m, _mm_loadu_pd(values + i));
+  m = _mm_max_sd(m, _mm_unpackhi_pd(m, m));
+  double result = _mm_cvtsd_f64(m);
+  // at most one element is left over
+  return i < count && values[i] > result ? values[i] : result;
+}
+
+static void sse2PrefixSum(double *values, size_t count) {
+  // [a, b] -> [a, a + b], then add the running total of the pairs before
+  __m128d carry = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m128d v = _mm_loadu_pd(values + i);
+    v = _mm_add_pd(v, _mm_unpacklo_pd(_mm_setzero_pd(), v));
+    v = _mm_add_pd(v, carry);
+    _mm_storeu_pd(values + i, v);
+    carry = _mm_unpackhi_pd(v, v);
+  }
+  if (i < count) values[i] += _mm_cvtsd_f64(carry);
+}
+
+static const Float64Kernels SSE2_KERNELS = {
+  "sse2", sse2Sum, sse2Dot, sse2Scale, sse2Add, sse2Min, sse2Max, sse2PrefixSum,
+};
+
+// AVX2 versions are compiled for that target only; float64Kernels() calls
+// them after checking the CPU.
+#define ASAS_AVX2 __attribute__((target("avx2")))
+
+ASAS_AVX2 static double avx2HorizontalSum(__m256d v) {
+  return horizontalSum(_mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+}
+
+ASAS_AVX2 static double avx2Sum(const double *values, size_t count) {
+  __m256d a = _mm256_setzero_pd(), b = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    a = _mm256_add_pd(a, _mm256_loadu_pd(values + i));
+    b = _mm256_add_pd(b, _mm256_loadu_pd(values + i + 4));
+  }
+  return avx2HorizontalSum(_mm256_add_pd(a, b)) + scalarSum(values + i, count - i);
+}
+
+ASAS_AVX2 static double avx2Dot(const double *left, const double *right, size_t count) {
+  __m256d a = _mm256_setzero_pd(), b = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    a = _mm256_add_pd(a, _mm256_mul_pd(_mm256_loadu_pd(left + i), _mm256_loadu_pd(right + i)));
+    b = _mm256_add_pd(b, _mm256_mul_pd(_mm256_loadu_pd(left + i + 4), _mm256_loadu_pd(right + i + 4)));
+  }
+  return avx2HorizontalSum(_mm256_add_pd(a, b)) + scalarDot(left + i, right + i, count - i);
+}
+
+ASAS_AVX2 static void avx2Scale(double *values, size_t count, double factor) {
+  __m256d f = _mm256_set1_pd(factor);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+    _mm256_storeu_pd(values + i, _mm256_mul_pd(_mm256_loadu_pd(values + i), f));
+  scalarScale(values + i, count - i, factor);
+}
+
+ASAS_AVX2 static void avx2Add(double *left, const double *right, size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+    _mm256_storeu_pd(left + i, _mm256_add_pd(_mm256_loadu_pd(left + i), _mm256_loadu_pd(right + i)));
+  scalarAdd(left + i, right + i, count - i);
+}
+
+ASAS_AVX2 static double avx2Min(const double *values, size_t count) {
+  if (count < 4) return scalarMin(values, count);
+  __m256d m = _mm256_loadu_pd(values);
+  size_t i = 4;
+  for (; i + 4 <= count; i += 4) m = _mm256_min_pd(m, _mm256_loadu_pd(values + i));
+  // the last, possibly overlapping, block covers the tail
+  if (i < count) m = _mm256_min_pd(m, _mm256_loadu_pd(values + count - 4));
+  __m128d half = _mm_min_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+  return _mm_cvtsd_f64(_mm_min_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+ASAS_AVX2 static double avx2Max(const double *values, size_t count) {
+  if (count < 4) return scalarMax(values, count);
+  __m256d m = _mm256_loadu_pd(values);
+  size_t i = 4;
+  for (; i + 4 <= count; i += 4) m = _mm256_max_pd(m, _mm256_loadu_pd(values + i));
+  if (i < count) m = _mm256_max_pd(m, _mm256_loadu_pd(values + count - 4));
+  __m128d half = _mm_max_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+  return _mm_cvtsd_f64(_mm_max_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+ASAS_AVX2 static void avx2PrefixSum(double *values, size_t count) {
+  // in-register scan of 4 lanes: shift by one lane and add, then by two
+  __m256d zero = _mm256_setzero_pd();
+  __m256d carry = zero;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256d v = _mm256_loadu_pd(values + i);
+    v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, 0x90), zero, 0x1));
+    v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, 0x40), zero, 0x3));
+    v = _mm256_add_pd(v, carry);
+    _mm256_storeu_pd(values + i, v);
+    carry = _mm256_permute4x64_pd(v, 0xff);
+  }
+  if (i == 0) return scalarPrefixSum(values, count);
+  for (; i < count; i++) values[i] += values[i - 1];
+}
+
+static const Float64Kernels AVX2_KERNELS = {
+  "avx2", avx2Sum, avx2Dot, avx2Scale, avx2Add, avx2Min, avx2Max, avx2PrefixSum,
+};
+
+#endif // ASAS_X86
+
+const Float64Kernels *float64KernelsFor(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::SCALAR: return &SCALAR_KERNELS;
+#ifdef ASAS_X86
+    case SimdLevel::SSE2: return __builtin_cpu_supports("sse2") ? &SSE2_KERNELS : nullptr;
+    case SimdLevel::AVX2: return __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : nullptr;
+#endif
+    default: return nullptr;
+  }
+}
+
+const Float64Kernels &float64Kernels() {
+  static const Float64Kernels *selected = []() {
+    for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::SSE2})
+      if (const Float64Kernels *kernels = float64KernelsFor(level)) return kernels;
+    return &SCALAR_KERNELS;
+  }();
+  return *selected;
+}
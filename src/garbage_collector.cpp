@@ -1,14 +1,28 @@
 #include "value.h"
 #include "vm.h"
+#include <chrono>
+
+static uint64_t nanosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
 
 void VM::collectGarbage() {
 #ifdef DEBUG_LOG_GC
   printf("Garbage collection triggered!\n");
 #endif
 
+  auto markStart = std::chrono::steady_clock::now();
   markRoots();
+  traceReferences(false);
+  uint64_t markTime = nanosSince(markStart);
 
+  auto sweepStart = std::chrono::steady_clock::now();
+  closeDeadFibers();
+  // pending samples point at functions that may be swept now
+  if (sampler_ != nullptr) sampler_->drain();
   freeObjects();
+  gcStats_.recordPause(markTime, nanosSince(sweepStart));
+  nextGC_ = std::max<size_t>(GC_INITIAL_THRESHOLD, allocatedObjects_.size() * GC_HEAP_GROW_FACTOR);
 #ifdef DEBUG_LOG_GC
   printf("Garbage collection completed.\n");
 #endif
@@ -19,6 +33,21 @@ void VM::markRoots() {
     markValue(&value, false);
   for (auto &[name, value] : globals_)
     markValue(&value, false);
+  markObject(currentFiber_, false);
+  for (ReadyFiber &ready : readyFibers_) {
+    markObject(ready.fiber, false);
+    markValue(&ready.value, false);
+  }
+  for (auto &[waitId, value] : mainResults_)
+    markValue(&value, false);
+  // waiting fibers are only referenced from event loop callbacks
+  for (AsasFiber *fiber : fibers_)
+    if (fiber->getState() == AsasFiber::FIBER_WAITING) markObject(fiber, false);
+  for (AsasObject *object : pinnedObjects_)
+    markObject(object, false);
+  scriptCache_.forEachFunction([this](AsasFunction *function) {
+    markObject(function, false);
+  });
   // for (auto &[name, upvalue] : openUpvalues_)
     // markObject(upvalue);
   for (CallFrame &frame : callFrames_) {
@@ -36,6 +65,7 @@ void VM::markRoots() {
 
 void VM::setupGarbageCollector(AsasObject* rootScript) {
   markObject(rootScript, true);
+  traceReferences(true);
 }
 
 void VM::markValue(Value *value, bool traceObject) {
@@ -47,35 +77,39 @@ void VM::markValue(Value *value, bool traceObject) {
 }
 
 void VM::markObject(AsasObject *object, bool traceObject) {
-  if (object == nullptr || object->isMarked()) return;
-  object->mark();
-  if (traceObject) allocatedObjects_.insert(object);
+  if (object == nullptr || !object->tryMark()) return;
+  if (traceObject && allocatedObjects_.insert(object).second) {
+    gcStats_.objectsAllocated++;
+    chargeObject(object);
+  }
 
 #ifdef DEBUG_LOG_GC
   printf("\033[0;35m");
   printf("Marking object %p of type %s\n", (void*)object, typeid(*object).name());
   printf("\033[0m");
-  // printValue("Value to mark: ", *reinterpret_cast<Value*>(object), "\n");
 #endif
 
-  if (auto fn = dynamic_cast<AsasFunction*>(object)) {
-    // markValue(reinterpret_cast<Value*>(fn->getAsasStringName()));
-    markObject(fn->getAsasStringName(), traceObject);
-    for (const Value &constant : fn->getChunk()->getConstants())
-      markValue(const_cast<Value*>(&constant), traceObject);
-      // markValue(const_cast<Value*>(&constant));
-      // markValue(const_cast<Value*>(&constant));
-    return;
-  }
-  if (auto upvalue = dynamic_cast<AsasUpvalue*>(object)) {
-    markValue(upvalue->getLocation(), traceObject);
+  grayObjects_.push_back(object);
+}
+
+void VM::traceReferences(bool traceObject) {
+  // tracing for the first time registers objects in allocatedObjects_,
+  // which is not thread safe, so only plain collections go parallel
+  if (!traceObject && allocatedObjects_.size() >= parallelMarkThreshold_) {
+    if (parallelMarker_ == nullptr) {
+      unsigned workers = std::min<unsigned>(std::thread::hardware_concurrency(), GC_MAX_MARKER_THREADS);
+      parallelMarker_ = std::make_unique<ParallelMarker>(std::max(workers, 2u));
+    }
+    parallelMarker_->mark(grayObjects_);
     return;
   }
-  if (auto closure = dynamic_cast<AsasClosure*>(object)) {
-    markObject(closure->getFunction(), traceObject);
-    for (AsasUpvalue* upvalue : closure->getUpvalues())
-      markObject(upvalue, traceObject);
-    return;
+
+  while (!grayObjects_.empty()) {
+    AsasObject *object = grayObjects_.back();
+    grayObjects_.pop_back();
+    forEachReference(object, [this, traceObject](AsasObject *ref) {
+      markObject(ref, traceObject);
+    });
   }
 }
 
@@ -83,14 +117,116 @@ void VM::markObject(AsasObject *object, bool traceObject) {
 void VM::freeObjects() {
   for (auto it = allocatedObjects_.begin(); it != allocatedObjects_.end(); ) {
     AsasObject* obj = *it;
-    if (obj->isMarked()) { obj->unmark(); ++it; } 
+    if (obj->isMarked()) { obj->unmark(); rechargeObject(obj); ++it; } 
     else {
 #ifdef DEBUG_LOG_GC
       printf("Freeing object %p of type %s\n", (void*)obj, typeid(*obj).name());
 #endif
-      delete obj; 
+      gcStats_.objectsFreed++;
+      gcStats_.bytesFreed += obj->getChargedBytes();
+      releaseObject(obj);
       it = allocatedObjects_.erase(it); 
       obj = nullptr;
     }
   }
 }
+
+// A survivor's arrays and tables may have grown (or shrunk) since it was
+// last charged; settle the difference so freeing it later credits no more
+// than was charged.
+void VM::rechargeObject(AsasObject *object) {
+  size_t bytes = objectByteSize(object);
+  size_t charged = object->getChargedBytes();
+  if (bytes == charged) return;
+  if (bytes > charged) gcStats_.bytesAllocated += bytes - charged;
+  else gcStats_.bytesFreed += charged - bytes;
+  object->setChargedBytes(bytes);
+}
+
+// Upvalues still open on the stack of an unreachable fiber would dangle once
+// its stack is gone; closing them first keeps closures that escaped valid.
+void VM::closeDeadFibers() {
+  std::erase_if(fibers_, [](AsasFiber *fiber) {
+    if (fiber->isMarked()) return false;
+    for (auto &[slot, upvalue] : fiber->getOpenUpvalues()) upvalue->close();
+    return true;
+  });
+}
+
+GcStats VM::getGcStats() const {
+  GcStats stats = gcStats_;
+  for (AsasObject *object : allocatedObjects_) {
+    size_t kind = static_cast<size_t>(objectKindOf(object));
+    size_t bytes = objectByteSize(object);
+    // growth since the last sweep, as that sweep would charge it
+    size_t charged = object->getChargedBytes();
+    if (bytes > charged) stats.bytesAllocated += bytes - charged;
+    else stats.bytesFreed += charged - bytes;
+    stats.liveObjects++;
+    stats.liveBytes += bytes;
+    stats.liveObjectsByKind[kind]++;
+    stats.liveBytesByKind[kind] += bytes;
+  }
+  stats.nextThreshold = nextGC_;
+  return stats;
+}
+
+// The roots are the ones markRoots() marks, one synthetic node per kind.
+HeapSnapshot VM::takeHeapSnapshot() const {
+  HeapSnapshot snapshot;
+  uint32_t root = snapshot.addNode(HeapSnapshot::SYNTHETIC, "", 0);
+  uint32_t category = 0;
+  auto addCategory = [&](const char *name) {
+    uint32_t node = snapshot.addNode(HeapSnapshot::SYNTHETIC, name, 0);
+    snapshot.addEdge(root, HeapSnapshot::ELEMENT, category++, node);
+    return node;
+  };
+  auto addRoot = [&snapshot](uint32_t from, uint32_t index, const Value &value) {
+    if (auto object = std::get_if<AsasObject*>(&value))
+      snapshot.addEdge(from, HeapSnapshot::ELEMENT, index, snapshot.addObject(*object));
+  };
+
+  uint32_t stack = addCategory("(stack)");
+  for (size_t i = 0; i < stack_.size(); i++) addRoot(stack, static_cast<uint32_t>(i), stack_[i]);
+
+  // named after the variable, so a leak shows up as "global x"
+  uint32_t globals = addCategory("(globals)");
+  for (const auto &[name, value] : globals_)
+    if (auto object = std::get_if<AsasObject*>(&value))
+      snapshot.addEdge(globals, HeapSnapshot::PROPERTY, name, snapshot.addObject(*object));
+
+  uint32_t fibers = addCategory("(fibers)");
+  uint32_t index = 0;
+  if (currentFiber_ != nullptr) addRoot(fibers, index++, currentFiber_);
+  for (const ReadyFiber &ready : readyFibers_) {
+    addRoot(fibers, index++, ready.fiber);
+    addRoot(fibers, index++, ready.value);
+  }
+  for (AsasFiber *fiber : fibers_)
+    if (fiber->getState() == AsasFiber::FIBER_WAITING) addRoot(fibers, index++, fiber);
+  for (const auto &[waitId, value] : mainResults_) addRoot(fibers, index++, value);
+
+  uint32_t pinned = addCategory("(pinned)");
+  for (size_t i = 0; i < pinnedObjects_.size(); i++)
+    addRoot(pinned, static_cast<uint32_t>(i), pinnedObjects_[i]);
+
+  uint32_t scripts = addCategory("(script cache)");
+  index = 0;
+  scriptCache_.forEachFunction([&](AsasFunction *function) { addRoot(scripts, index++, function); });
+
+  uint32_t frames = addCategory("(call frames)");
+  index = 0;
+  for (const CallFrame &frame : callFrames_) {
+    AsasClosure *closure = frame.getClosure();
+    addRoot(frames, index++, closure);
+    for (AsasUpvalue *upvalue : closure->getUpvalues()) addRoot(frames, index++, upvalue);
+    addRoot(frames, index++, closure->getFunction());
+  }
+  snapshot.addReferences();
+
+  // what is left is garbage the next collection frees; it is listed,
+  // but nothing leads to it from the root
+  for (AsasObject *object : allocatedObjects_) snapshot.addObject(object);
+  snapshot.addReferences();
+  return snapshot;
+}
@@ -0,0 +1,87 @@
+#include "gc_stats.h"
+#include "asas_map.h"
+#include "fiber.h"
+#include "float64_array.h"
+#include "object.h"
+
+ObjectKind objectKindOf(AsasObject *object) { return object->getKind(); }
+
+const char *objectKindName(ObjectKind kind) {
+  switch (kind) {
+  case ObjectKind::STRING: return "string";
+  case ObjectKind::ROPE: return "rope";
+  case ObjectKind::FUNCTION: return "function";
+  case ObjectKind::NATIVE_FUNCTION: return "native";
+  case ObjectKind::UPVALUE: return "upvalue";
+  case ObjectKind::CLOSURE: return "closure";
+  case ObjectKind::FIBER: return "fiber";
+  case ObjectKind::ARRAY: return "array";
+  case ObjectKind::MAP: return "map";
+  case ObjectKind::FLOAT64_ARRAY: return "float64array";
+  default: return "object";
+  }
+}
+
+size_t objectByteSize(AsasObject *object) {
+  // on every allocation and free: the kind is in the header, so no casts
+  switch (object->getKind()) {
+  case ObjectKind::STRING:
+    return AsasString::allocationSize(static_cast<AsasString*>(object)->getLength());
+  case ObjectKind::ROPE: return sizeof(AsasRope);
+  case ObjectKind::FUNCTION: {
+    const Chunk *chunk = static_cast<AsasFunction*>(object)->getChunk();
+    return sizeof(AsasFunction) +
+           chunk->getCode().size() * (sizeof(uint8_t) + sizeof(int)) +
+           chunk->getConstants().size() * sizeof(Value);
+  }
+  case ObjectKind::NATIVE_FUNCTION: return sizeof(AsasNativeFunction);
+  case ObjectKind::UPVALUE: return sizeof(AsasUpvalue);
+  case ObjectKind::CLOSURE:
+    return sizeof(AsasClosure) +
+           static_cast<AsasClosure*>(object)->getUpvalues().size() * sizeof(AsasUpvalue*);
+  case ObjectKind::FIBER: {
+    auto fiber = static_cast<AsasFiber*>(object);
+    return sizeof(AsasFiber) + fiber->getStack().capacity() * sizeof(Value) +
+           fiber->getCallFrames().capacity() * sizeof(CallFrame);
+  }
+  case ObjectKind::ARRAY:
+    return sizeof(AsasArray) + static_cast<AsasArray*>(object)->getElements().capacity() * sizeof(Value);
+  case ObjectKind::MAP:
+    return sizeof(AsasMap) + static_cast<AsasMap*>(object)->capacity() * (1 + 2 * sizeof(Value));
+  case ObjectKind::FLOAT64_ARRAY:
+    return sizeof(AsasFloat64Array) + static_cast<AsasFloat64Array*>(object)->size() * sizeof(double);
+  default: return sizeof(AsasObject);
+  }
+}
+
+std::string GcStats::toJson() const {
+  auto field = [](const char *name, uint64_t value) {
+    return std::string("  \"") + name + "\": " + std::to_string(value) + ",\n";
+  };
+  std::string json = "{\n";
+  json += field("collections", collections);
+  json += field("objects_allocated", objectsAllocated);
+  json += field("objects_freed", objectsFreed);
+  json += field("bytes_allocated", bytesAllocated);
+  json += field("bytes_freed", bytesFreed);
+  json += field("live_objects", liveObjects);
+  json += field("live_bytes", liveBytes);
+  json += field("next_threshold", nextThreshold);
+  json += field("mark_ns", markNanos);
+  json += field("sweep_ns", sweepNanos);
+  json += field("total_pause_ns", totalPauseNanos);
+  json += field("max_pause_ns", maxPauseNanos);
+  json += "  \"avg_pause_ns\": " + std::to_string(static_cast<uint64_t>(averagePauseNanos())) + ",\n";
+  json += "  \"live_by_type\": {";
+  bool first = true;
+  for (size_t kind = 0; kind < OBJECT_KIND_COUNT; kind++) {
+    if (liveObjectsByKind[kind] == 0) continue;
+    json += first ? "\n" : ",\n";
+    first = false;
+    json += std::string("    \"") + objectKindName(static_cast<ObjectKind>(kind)) +
+            "\": {\"objects\": " + std::to_string(liveObjectsByKind[kind]) +
+            ", \"bytes\": " + std::to_string(liveBytesByKind[kind]) + "}";
+  }
+  json += first ? "}\n}\n" : "\n  }\n}\n";
+  return json;
+}
@@ -0,0 +1,615 @@
+#include "heap_snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include "gc_stats.h"
+#include "parallel_marker.h"
+
+// longer strings are cut in node names; the node keeps the full size
+static constexpr size_t MAX_NAME_LENGTH = 200;
+static constexpr uint32_t UNREACHABLE = UINT32_MAX;
+static constexpr size_t NODE_FIELD_COUNT = 7;
+
+static const char *const NODE_TYPE_NAMES[HeapSnapshot::NODE_TYPE_COUNT] = {
+  "hidden", "array", "string", "object", "code", "closure", "regexp", "number", "native",
+  "synthetic", "concatenated string", "sliced string", "symbol", "bigint"
+};
+static const char *const EDGE_TYPE_NAMES[HeapSnapshot::EDGE_TYPE_COUNT] = {
+  "context", "element", "property", "internal", "hidden", "shortcut", "weak"
+};
+
+const char *HeapSnapshot::nodeTypeName(NodeType type) {
+  return type < NODE_TYPE_COUNT ? NODE_TYPE_NAMES[type] : "hidden";
+}
+
+const char *HeapSnapshot::edgeTypeName(EdgeType type) {
+  return type < EDGE_TYPE_COUNT ? EDGE_TYPE_NAMES[type] : "hidden";
+}
+
+// element and hidden edges are numbered, the others named
+static bool isIndexEdge(HeapSnapshot::EdgeType type) {
+  return type == HeapSnapshot::ELEMENT || type == HeapSnapshot::HIDDEN_EDGE;
+}
+
+uint32_t HeapSnapshot::intern(const std::string &string) {
+  auto [it, inserted] = stringIndex_.try_emplace(string, static_cast<uint32_t>(strings_.size()));
+  if (inserted) strings_.push_back(string);
+  return it->second;
+}
+
+uint32_t HeapSnapshot::addNode(NodeType type, const std::string &name, uint64_t selfSize) {
+  uint32_t node = static_cast<uint32_t>(nodes_.size());
+  // V8 gives heap objects odd ids
+  nodes_.push_back(Node{type, intern(name), 2 * static_cast<uint64_t>(node) + 1, selfSize, {}});
+  return node;
+}
+
+void HeapSnapshot::addEdge(uint32_t from, EdgeType type, const std::string &name, uint32_t to) {
+  nodes_[from].edges.push_back(Edge{type, intern(name), to});
+}
+
+void HeapSnapshot::addEdge(uint32_t from, EdgeType type, uint32_t index, uint32_t to) {
+  nodes_[from].edges.push_back(Edge{type, index, to});
+}
+
+static std::string stringName(AsasObject *object) {
+  std::string name;
+  auto append = [&name](const char *chars, int length) {
+    size_t room = MAX_NAME_LENGTH - name.size();
+    name.append(chars, std::min(room, static_cast<size_t>(length)));
+  };
+  if (auto string = dynamic_cast<AsasString*>(object))
+    append(string->getData(), string->getLength());
+  else
+    static_cast<AsasRope*>(object)->forEachPiece(append);
+  return name;
+}
+
+uint32_t HeapSnapshot::addObject(AsasObject *object) {
+  auto known = objectNodes_.find(object);
+  if (known != objectNodes_.end()) return known->second;
+
+  NodeType type = OBJECT;
+  std::string name;
+  switch (objectKindOf(object)) {
+  case ObjectKind::STRING: type = STRING; name = stringName(object); break;
+  case ObjectKind::ROPE: type = CONCATENATED_STRING; name = stringName(object); break;
+  case ObjectKind::FUNCTION: type = CODE; name = static_cast<AsasFunction*>(object)->getName(); break;
+  case ObjectKind::NATIVE_FUNCTION:
+    type = CLOSURE;
+    name = static_cast<AsasNativeFunction*>(object)->getName();
+    break;
+  case ObjectKind::CLOSURE:
+    type = CLOSURE;
+    name = static_cast<AsasClosure*>(object)->getFunction()->getName();
+    break;
+  case ObjectKind::UPVALUE: type = HIDDEN; name = "upvalue"; break;
+  case ObjectKind::FIBER: name = "Fiber"; break;
+  case ObjectKind::ARRAY: name = "Array"; break;
+  case ObjectKind::MAP: name = "Map"; break;
+  case ObjectKind::FLOAT64_ARRAY: name = "Float64Array"; break;
+  default: name = "Object"; break;
+  }
+
+  uint32_t node = addNode(type, name, objectByteSize(object));
+  objectNodes_.emplace(object, node);
+  unexpanded_.emplace_back(object, node);
+  return node;
+}
+
+void HeapSnapshot::addReferences() {
+  // breadth first; addObject() appends while this runs
+  for (size_t i = 0; i < unexpanded_.size(); i++) {
+    auto [object, node] = unexpanded_[i];
+    uint32_t index = 0;
+    forEachReference(object, [this, node, &index](AsasObject *reference) {
+      if (reference == nullptr) return;
+      uint32_t to = addObject(reference);
+      addEdge(node, ELEMENT, index++, to);
+    });
+  }
+  unexpanded_.clear();
+}
+
+std::string HeapSnapshot::describe(uint32_t node) const {
+  const Node &n = nodes_[node];
+  const std::string &name = strings_[n.name];
+  if (n.type == SYNTHETIC) return name;
+  if (n.type == STRING || n.type == CONCATENATED_STRING || n.type == SLICED_STRING)
+    return std::string("string \"") + name + "\"";
+  if (name.empty()) return nodeTypeName(n.type);
+  return std::string(nodeTypeName(n.type)) + " " + name;
+}
+
+static void appendJsonString(std::string &out, const std::string &string) {
+  out += '"';
+  for (unsigned char c : string) {
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    default:
+      if (c < 0x20) {
+        char escape[8];
+        snprintf(escape, sizeof(escape), "\\u%04x", c);
+        out += escape;
+      } else {
+        out += static_cast<char>(c);
+      }
+    }
+  }
+  out += '"';
+}
+
+std::string HeapSnapshot::toJson() const {
+  size_t edgeCount = 0;
+  for (const Node &node : nodes_) edgeCount += node.edges.size();
+
+  std::string json = "{\"snapshot\":{\"meta\":{"
+      "\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\",\"edge_count\",\"trace_node_id\",\"detachedness\"],"
+      "\"node_types\":[[";
+  for (size_t type = 0; type < NODE_TYPE_COUNT; type++) {
+    if (type > 0) json += ',';
+    appendJsonString(json, NODE_TYPE_NAMES[type]);
+  }
+  json += "],\"string\",\"number\",\"number\",\"number\",\"number\",\"number\"],"
+          "\"edge_fields\":[\"type\",\"name_or_index\",\"to_node\"],"
+          "\"edge_types\":[[";
+  for (size_t type = 0; type < EDGE_TYPE_COUNT; type++) {
+    if (type > 0) json += ',';
+    appendJsonString(json, EDGE_TYPE_NAMES[type]);
+  }
+  json += "],\"string_or_number\",\"node\"],"
+          "\"trace_function_info_fields\":[],\"trace_node_fields\":[],"
+          "\"sample_fields\":[],\"location_fields\":[]},";
+  json += "\"node_count\":" + std::to_string(nodes_.size()) +
+          ",\"edge_count\":" + std::to_string(edgeCount) + ",\"trace_function_count\":0},\n";
+
+  // one node or edge per line keeps the file diffable
+  json += "\"nodes\":[";
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    const Node &node = nodes_[i];
+    json += i == 0 ? "" : ",\n";
+    json += std::to_string(node.type) + ',' + std::to_string(node.name) + ',' +
+            std::to_string(node.id) + ',' + std::to_string(node.selfSize) + ',' +
+            std::to_string(node.edges.size()) + ",0,0";
+  }
+  json += "],\n\"edges\":[";
+  bool first = true;
+  for (const Node &node : nodes_) {
+    for (const Edge &edge : node.edges) {
+      json += first ? "" : ",\n";
+      first = false;
+      json += std::to_string(edge.type) + ',' + std::to_string(edge.nameOrIndex) + ',' +
+              std::to_string(static_cast<uint64_t>(edge.to) * NODE_FIELD_COUNT);
+    }
+  }
+  json += "],\n\"trace_function_infos\":[],\"trace_tree\":[],\"samples\":[],\"locations\":[],\n\"strings\":[";
+  for (size_t i = 0; i < strings_.size(); i++) {
+    json += i == 0 ? "" : ",\n";
+    appendJsonString(json, strings_[i]);
+  }
+  json += "]}\n";
+  return json;
+}
+
+namespace {
+
+// Just enough JSON for heap snapshots: objects are walked member by member
+// and only the arrays a snapshot needs are kept, so a snapshot of a large
+// browser heap doesn't become a tree of values first.
+class JsonReader {
+public:
+  explicit JsonReader(const std::string &json) : p_(json.data()), end_(json.data() + json.size()) {}
+
+  bool consume(char c) {
+    skipSpace();
+    if (p_ == end_ || *p_ != c) return false;
+    p_++;
+    return true;
+  }
+  bool atEnd() {
+    skipSpace();
+    return p_ == end_;
+  }
+
+  // calls member(key) for every member; it has to read the value
+  template<typename Fn>
+  bool readObject(Fn &&member) {
+    if (!consume('{')) return false;
+    if (consume('}')) return true;
+    do {
+      std::string key;
+      if (!readString(key) || !consume(':') || !member(key)) return false;
+    } while (consume(','));
+    return consume('}');
+  }
+
+  bool readString(std::string &out) {
+    out.clear();
+    if (!consume('"')) return false;
+    while (p_ != end_ && *p_ != '"') {
+      char c = *p_++;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (p_ == end_) return false;
+      switch (*p_++) {
+      case '"': out += '"'; break;
+      case '\\': out += '\\'; break;
+      case '/': out += '/'; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        uint32_t code;
+        if (!readHex(code)) return false;
+        if (code >= 0xd800 && code < 0xdc00 && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u') {
+          p_ += 2;
+          uint32_t low;
+          if (!readHex(low)) return false;
+          code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+        }
+        appendUtf8(out, code);
+        break;
+      }
+      default: return false;
+      }
+    }
+    return consume('"');
+  }
+
+  bool readNumber(uint64_t &out) {
+    skipSpace();
+    if (p_ == end_ || *p_ < '0' || *p_ > '9') return false;
+    out = 0;
+    while (p_ != end_ && *p_ >= '0' && *p_ <= '9') out = out * 10 + (*p_++ - '0');
+    return true;
+  }
+
+  bool readNumbers(std::vector<uint64_t> &out) {
+    if (!consume('[')) return false;
+    if (consume(']')) return true;
+    do {
+      uint64_t number;
+      if (!readNumber(number)) return false;
+      out.push_back(number);
+    } while (consume(','));
+    return consume(']');
+  }
+
+  bool readStrings(std::vector<std::string> &out) {
+    if (!consume('[')) return false;
+    if (consume(']')) return true;
+    do {
+      out.emplace_back();
+      if (!readString(out.back())) return false;
+    } while (consume(','));
+    return consume(']');
+  }
+
+  // [[names...], more...] as the node_types and edge_types of the meta
+  bool readTypeNames(std::vector<std::string> &out) {
+    if (!consume('[') || !readStrings(out)) return false;
+    while (consume(','))
+      if (!skipValue()) return false;
+    return consume(']');
+  }
+
+  bool skipValue() {
+    skipSpace();
+    if (p_ == end_) return false;
+    if (*p_ == '"') {
+      std::string ignored;
+      return readString(ignored);
+    }
+    if (*p_ == '{') return readObject([this](const std::string &) { return skipValue(); });
+    if (*p_ == '[') {
+      p_++;
+      if (consume(']')) return true;
+      do {
+        if (!skipValue()) return false;
+      } while (consume(','));
+      return consume(']');
+    }
+    // numbers, true, false, null
+    const char *start = p_;
+    while (p_ != end_ && strchr(",]} \t\r\n", *p_) == nullptr) p_++;
+    return p_ != start;
+  }
+
+private:
+  void skipSpace() {
+    while (p_ != end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) p_++;
+  }
+  bool readHex(uint32_t &out) {
+    if (end_ - p_ < 4) return false;
+    out = 0;
+    for (int i = 0; i < 4; i++) {
+      char c = *p_++;
+      out <<= 4;
+      if (c >= '0' && c <= '9') out |= c - '0';
+      else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+      else return false;
+    }
+    return true;
+  }
+  static void appendUtf8(std::string &out, uint32_t code) {
+    if (code < 0x80) {
+      out += static_cast<char>(code);
+    } else if (code < 0x800) {
+      out += static_cast<char>(0xc0 | (code >> 6));
+      out += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+      out += static_cast<char>(0xe0 | (code >> 12));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+      out += static_cast<char>(0xf0 | (code >> 18));
+      out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+  }
+
+  const char *p_;
+  const char *end_;
+};
+
+size_t fieldIndex(const std::vector<std::string> &fields, const char *name) {
+  auto found = std::find(fields.begin(), fields.end(), name);
+  return found == fields.end() ? SIZE_MAX : static_cast<size_t>(found - fields.begin());
+}
+
+template<typename Type>
+Type typeByName(const std::vector<std::string> &names, uint64_t index, const char *const *known,
+                size_t knownCount, Type fallback) {
+  if (index >= names.size()) return fallback;
+  for (size_t type = 0; type < knownCount; type++)
+    if (names[index] == known[type]) return static_cast<Type>(type);
+  return fallback;
+}
+
+} // namespace
+
+bool HeapSnapshot::parse(const std::string &json, HeapSnapshot &snapshot, std::string &error) {
+  std::vector<std::string> nodeFields, edgeFields, nodeTypes, edgeTypes, strings;
+  std::vector<uint64_t> nodes, edges;
+
+  JsonReader reader(json);
+  bool read = reader.readObject([&](const std::string &key) {
+    if (key == "snapshot") {
+      return reader.readObject([&](const std::string &snapshotKey) {
+        if (snapshotKey != "meta") return reader.skipValue();
+        return reader.readObject([&](const std::string &metaKey) {
+          if (metaKey == "node_fields") return reader.readStrings(nodeFields);
+          if (metaKey == "edge_fields") return reader.readStrings(edgeFields);
+          if (metaKey == "node_types") return reader.readTypeNames(nodeTypes);
+          if (metaKey == "edge_types") return reader.readTypeNames(edgeTypes);
+          return reader.skipValue();
+        });
+      });
+    }
+    if (key == "nodes") return reader.readNumbers(nodes);
+    if (key == "edges") return reader.readNumbers(edges);
+    if (key == "strings") return reader.readStrings(strings);
+    return reader.skipValue();
+  });
+  if (!read || !reader.atEnd()) {
+    error = "not a heap snapshot: malformed JSON";
+    return false;
+  }
+
+  size_t nodeFieldCount = nodeFields.size();
+  size_t typeField = fieldIndex(nodeFields, "type");
+  size_t nameField = fieldIndex(nodeFields, "name");
+  size_t idField = fieldIndex(nodeFields, "id");
+  size_t sizeField = fieldIndex(nodeFields, "self_size");
+  size_t edgeCountField = fieldIndex(nodeFields, "edge_count");
+  size_t edgeFieldCount = edgeFields.size();
+  size_t edgeTypeField = fieldIndex(edgeFields, "type");
+  size_t edgeNameField = fieldIndex(edgeFields, "name_or_index");
+  size_t toField = fieldIndex(edgeFields, "to_node");
+  if (typeField == SIZE_MAX || nameField == SIZE_MAX || idField == SIZE_MAX || sizeField == SIZE_MAX ||
+      edgeCountField == SIZE_MAX || edgeTypeField == SIZE_MAX || edgeNameField == SIZE_MAX ||
+      toField == SIZE_MAX) {
+    error = "not a heap snapshot: missing node or edge fields in snapshot.meta";
+    return false;
+  }
+  if (nodes.size() % nodeFieldCount != 0 || edges.size() % edgeFieldCount != 0) {
+    error = "truncated nodes or edges";
+    return false;
+  }
+
+  HeapSnapshot result;
+  result.strings_ = std::move(strings);
+  for (size_t i = result.strings_.size(); i-- > 0;)
+    result.stringIndex_[result.strings_[i]] = static_cast<uint32_t>(i);
+
+  size_t nodeCount = nodes.size() / nodeFieldCount;
+  result.nodes_.resize(nodeCount);
+  size_t edge = 0;
+  for (size_t i = 0; i < nodeCount; i++) {
+    const uint64_t *fields = &nodes[i * nodeFieldCount];
+    Node &node = result.nodes_[i];
+    node.type = typeByName(nodeTypes, fields[typeField], NODE_TYPE_NAMES, NODE_TYPE_COUNT, HIDDEN);
+    node.name = static_cast<uint32_t>(fields[nameField]);
+    node.id = fields[idField];
+    node.selfSize = fields[sizeField];
+    if (node.name >= result.strings_.size()) {
+      error = "node name out of range";
+      return false;
+    }
+
+    uint64_t count = fields[edgeCountField];
+    if (count > (edges.size() - edge) / edgeFieldCount) {
+      error = "more edges referenced than listed";
+      return false;
+    }
+    node.edges.reserve(count);
+    for (uint64_t e = 0; e < count; e++, edge += edgeFieldCount) {
+      EdgeType type = typeByName(edgeTypes, edges[edge + edgeTypeField], EDGE_TYPE_NAMES, EDGE_TYPE_COUNT,
+                                 HIDDEN_EDGE);
+      uint64_t nameOrIndex = edges[edge + edgeNameField];
+      uint64_t to = edges[edge + toField];
+      if (to % nodeFieldCount != 0 || to / nodeFieldCount >= nodeCount ||
+          (!isIndexEdge(type) && nameOrIndex >= result.strings_.size())) {
+        error = "edge out of range";
+        return false;
+      }
+      node.edges.push_back(Edge{type, static_cast<uint32_t>(nameOrIndex),
+                                static_cast<uint32_t>(to / nodeFieldCount)});
+    }
+  }
+
+  snapshot = std::move(result);
+  return true;
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm": iterate
+// over the reverse postorder until no immediate dominator changes.
+std::vector<uint32_t> HeapSnapshot::dominators() const {
+  std::vector<uint32_t> postorder;
+  return dominators(postorder);
+}
+
+std::vector<uint32_t> HeapSnapshot::dominators(std::vector<uint32_t> &postorder) const {
+  size_t count = nodes_.size();
+  std::vector<uint32_t> dominator(count, UNREACHABLE);
+  postorder.clear();
+  if (count == 0) return dominator;
+
+  std::vector<uint32_t> position(count, UNREACHABLE); // in postorder
+  std::vector<bool> visited(count, false);
+  std::vector<std::pair<uint32_t, size_t>> stack{{0, 0}};
+  visited[0] = true;
+  while (!stack.empty()) {
+    auto &[node, next] = stack.back();
+    const std::vector<Edge> &edges = nodes_[node].edges;
+    if (next < edges.size()) {
+      const Edge &edge = edges[next++];
+      if (edge.type != WEAK && !visited[edge.to]) {
+        visited[edge.to] = true;
+        stack.emplace_back(edge.to, 0);
+      }
+      continue;
+    }
+    position[node] = static_cast<uint32_t>(postorder.size());
+    postorder.push_back(node);
+    stack.pop_back();
+  }
+
+  // predecessors of the reachable nodes, flattened
+  std::vector<uint32_t> firstPredecessor(count + 1, 0);
+  for (uint32_t node : postorder)
+    for (const Edge &edge : nodes_[node].edges)
+      if (edge.type != WEAK) firstPredecessor[edge.to + 1]++;
+  for (size_t i = 0; i < count; i++) firstPredecessor[i + 1] += firstPredecessor[i];
+  std::vector<uint32_t> predecessors(firstPredecessor[count]);
+  std::vector<uint32_t> filled(firstPredecessor.begin(), firstPredecessor.end() - 1);
+  for (uint32_t node : postorder)
+    for (const Edge &edge : nodes_[node].edges)
+      if (edge.type != WEAK) predecessors[filled[edge.to]++] = node;
+
+  auto intersect = [&](uint32_t a, uint32_t b) {
+    while (a != b) {
+      while (position[a] < position[b]) a = dominator[a];
+      while (position[b] < position[a]) b = dominator[b];
+    }
+    return a;
+  };
+
+  dominator[0] = 0;
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t i = postorder.size() - 1; i-- > 0;) { // the root is last
+      uint32_t node = postorder[i];
+      uint32_t candidate = UNREACHABLE;
+      for (uint32_t p = firstPredecessor[node]; p < firstPredecessor[node + 1]; p++) {
+        uint32_t predecessor = predecessors[p];
+        if (dominator[predecessor] == UNREACHABLE) continue;
+        candidate = candidate == UNREACHABLE ? predecessor : intersect(predecessor, candidate);
+      }
+      if (dominator[node] != candidate) {
+        dominator[node] = candidate;
+        changed = true;
+      }
+    }
+  }
+  return dominator;
+}
+
+std::vector<HeapSnapshot::Retainer> HeapSnapshot::biggestRetainers(size_t count) const {
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> dominator = dominators(order);
+  size_t nodeCount = nodes_.size();
+
+  // a dominator is an ancestor in the depth first tree, so in postorder
+  // every node comes before its dominator
+  std::vector<uint64_t> retained(nodeCount, 0);
+  std::vector<uint32_t> dominated(nodeCount, 0);
+  for (uint32_t node : order) {
+    retained[node] += nodes_[node].selfSize;
+    dominated[node]++;
+    if (node == 0) continue;
+    retained[dominator[node]] += retained[node];
+    dominated[dominator[node]] += dominated[node];
+  }
+
+  std::vector<Retainer> retainers;
+  for (uint32_t node : order) {
+    if (node == 0 || nodes_[node].type == SYNTHETIC) continue;
+    retainers.push_back(Retainer{node, dominator[node], retained[node], dominated[node]});
+  }
+  auto bigger = [](const Retainer &a, const Retainer &b) {
+    return a.retainedSize != b.retainedSize ? a.retainedSize > b.retainedSize : a.node < b.node;
+  };
+  count = std::min(count, retainers.size());
+  std::partial_sort(retainers.begin(), retainers.begin() + count, retainers.end(), bigger);
+  retainers.resize(count);
+  return retainers;
+}
+
+std::string HeapSnapshot::summary(size_t count) const {
+  std::vector<uint32_t> dominator = dominators();
+  uint64_t objects = 0, bytes = 0, reachableObjects = 0, reachableBytes = 0;
+  for (uint32_t node = 0; node < nodes_.size(); node++) {
+    if (nodes_[node].type == SYNTHETIC) continue;
+    objects++;
+    bytes += nodes_[node].selfSize;
+    if (dominator[node] == UNREACHABLE) continue;
+    reachableObjects++;
+    reachableBytes += nodes_[node].selfSize;
+  }
+
+  auto shortName = [this](uint32_t node) {
+    std::string name = describe(node);
+    if (name.size() > 60) name = name.substr(0, 57) + "...";
+    for (char &c : name)
+      if (c == '\n' || c == '\t') c = ' ';
+    return name;
+  };
+
+  char line[256];
+  snprintf(line, sizeof(line), "%llu objects, %llu bytes; %llu objects, %llu bytes reachable from the roots\n",
+           static_cast<unsigned long long>(objects), static_cast<unsigned long long>(bytes),
+           static_cast<unsigned long long>(reachableObjects), static_cast<unsigned long long>(reachableBytes));
+  std::string out = line;
+  out += "\n    retained        self   objects  object <- held by\n";
+  for (const Retainer &retainer : biggestRetainers(count)) {
+    snprintf(line, sizeof(line), "%12llu %11llu %9u  ",
+             static_cast<unsigned long long>(retainer.retainedSize),
+             static_cast<unsigned long long>(nodes_[retainer.node].selfSize), retainer.dominatedCount);
+    out += line;
+    out += shortName(retainer.node);
+    out += " <- ";
+    out += retainer.dominator == 0 ? "(root)" : shortName(retainer.dominator);
+    out += '\n';
+  }
+  return out;
+}
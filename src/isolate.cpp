@@ -0,0 +1,10 @@
+#include "isolate.h"
+
+void Isolate::resetObjectCounts() {
+  for (auto &count : objectCounts_) count.store(0, std::memory_order_relaxed);
+}
+
+Isolate &Isolate::threadDefault() {
+  thread_local Isolate isolate;
+  return isolate;
+}
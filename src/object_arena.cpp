@@ -0,0 +1,67 @@
+#include "object_arena.h"
+#include <new>
+
+// Slabs are cache line aligned, and so are the 64 byte blocks inside them.
+static constexpr std::align_val_t SLAB_ALIGNMENT{64};
+
+ObjectArena::~ObjectArena() {
+  for (SizeClass &sizeClass : classes_)
+    for (char *slab : sizeClass.slabs)
+      ::operator delete(slab, SLAB_ALIGNMENT);
+}
+
+uint8_t ObjectArena::sizeClassFor(size_t size) {
+  for (uint8_t i = 0; i < ARENA_SIZE_CLASSES; i++)
+    if (size <= blockSizes_[i]) return i;
+  return HEAP_CLASS;
+}
+
+void *ObjectArena::allocate(size_t size, uint8_t &sizeClass) {
+  sizeClass = sizeClassFor(size);
+  if (sizeClass == HEAP_CLASS) return nullptr;
+
+  SizeClass &cls = classes_[sizeClass];
+  cls.liveBlocks++;
+  if (cls.freeList != nullptr) {
+    FreeBlock *block = cls.freeList;
+    cls.freeList = block->next;
+    cls.freeBlocks--;
+    return block;
+  }
+
+  size_t blockSize = blockSizes_[sizeClass];
+  if (cls.bump == nullptr || cls.bump + blockSize > cls.bumpEnd) addSlab(cls);
+  void *block = cls.bump;
+  cls.bump += blockSize;
+  return block;
+}
+
+void ObjectArena::deallocate(void *block, uint8_t sizeClass) {
+  SizeClass &cls = classes_[sizeClass];
+  FreeBlock *freeBlock = static_cast<FreeBlock*>(block);
+  freeBlock->next = cls.freeList;
+  cls.freeList = freeBlock;
+  cls.liveBlocks--;
+  cls.freeBlocks++;
+}
+
+void ObjectArena::addSlab(SizeClass &cls) {
+  char *slab = static_cast<char*>(::operator new(ARENA_SLAB_SIZE, SLAB_ALIGNMENT));
+  cls.slabs.push_back(slab);
+  cls.bump = slab;
+  cls.bumpEnd = slab + ARENA_SLAB_SIZE;
+}
+
+ArenaStats ObjectArena::getStats() const {
+  ArenaStats stats;
+  for (uint8_t i = 0; i < ARENA_SIZE_CLASSES; i++) {
+    const SizeClass &cls = classes_[i];
+    stats.slabCount += cls.slabs.size();
+    stats.liveBlocks += cls.liveBlocks;
+    stats.freeBlocks += cls.freeBlocks;
+    stats.liveBytes += cls.liveBlocks * blockSizes_[i];
+    stats.freeListBytes += cls.freeBlocks * blockSizes_[i];
+  }
+  stats.reservedBytes = stats.slabCount * ARENA_SLAB_SIZE;
+  return stats;
+}
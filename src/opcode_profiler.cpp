@@ -0,0 +1,151 @@
+#include "opcode_profiler.h"
+#include <algorithm>
+#include <bit>
+#include "debug.h"
+
+void OpcodeProfiler::reset() {
+  counts_.fill(0);
+  samples_.fill(0);
+  cycles_.fill(0);
+  for (auto &row : pairs_) row.fill(0);
+  for (auto &histogram : histograms_) histogram.fill(0);
+  previous_ = NO_OPCODE;
+  timing_ = false;
+  countdown_ = OPCODE_PROFILE_SAMPLE_PERIOD;
+  start_ = 0;
+}
+
+uint64_t OpcodeProfiler::getTotalCount() const {
+  uint64_t total = 0;
+  for (uint64_t count : counts_) total += count;
+  return total;
+}
+
+void OpcodeProfiler::addSample(uint8_t opcode, uint64_t cycles) {
+  samples_[opcode]++;
+  cycles_[opcode] += cycles;
+  size_t bucket = std::min<size_t>(cycles <= 1 ? 0 : std::bit_width(cycles) - 1, OPCODE_PROFILE_BUCKETS - 1);
+  histograms_[static_cast<size_t>(classOf(opcode))][bucket]++;
+}
+
+OpcodeClass OpcodeProfiler::classOf(uint8_t opcode) {
+  switch (opcode) {
+  case OP_CONSTANT: case OP_NIL: case OP_TRUE: case OP_FALSE: case OP_POP: case OP_POP_UNTIL:
+    return OpcodeClass::STACK;
+  case OP_DEFINE_GLOBAL: case OP_GET_GLOBAL: case OP_SET_GLOBAL: case OP_GET_UPVALUE:
+  case OP_SET_UPVALUE: case OP_GET_LOCAL: case OP_SET_LOCAL: case OP_CLOSE_UPVALUE:
+    return OpcodeClass::VARIABLE;
+  case OP_EQUAL: case OP_GREATER: case OP_LESS: case OP_ADD: case OP_SUBTRACT:
+  case OP_MULTIPLY: case OP_DIVIDE: case OP_NOT: case OP_NEGATE:
+    return OpcodeClass::ARITHMETIC;
+  case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_LOOP:
+    return OpcodeClass::CONTROL;
+  case OP_CALL: case OP_CLOSURE: case OP_YIELD: case OP_RESUME: case OP_RETURN:
+    return OpcodeClass::CALL;
+  case OP_ARRAY: case OP_MAP: case OP_GET_INDEX: case OP_SET_INDEX: case OP_LENGTH:
+    return OpcodeClass::OBJECT;
+  default:
+    return OpcodeClass::OUTPUT;
+  }
+}
+
+const char *OpcodeProfiler::className(OpcodeClass opcodeClass) {
+  switch (opcodeClass) {
+  case OpcodeClass::STACK: return "stack";
+  case OpcodeClass::VARIABLE: return "variable";
+  case OpcodeClass::ARITHMETIC: return "arithmetic";
+  case OpcodeClass::CONTROL: return "control";
+  case OpcodeClass::CALL: return "call";
+  case OpcodeClass::OBJECT: return "object";
+  default: return "output";
+  }
+}
+
+std::vector<OpcodeProfiler::Pair> OpcodeProfiler::topPairs() const {
+  std::vector<Pair> pairs;
+  for (int first = 0; first < OP_COUNT; first++)
+    for (int second = 0; second < OP_COUNT; second++)
+      if (pairs_[first][second] != 0)
+        pairs.push_back(Pair{static_cast<uint8_t>(first), static_cast<uint8_t>(second), pairs_[first][second]});
+  std::sort(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b) { return a.count > b.count; });
+  if (pairs.size() > TOP_PAIRS) pairs.resize(TOP_PAIRS);
+  return pairs;
+}
+
+// opcodes that ran at least once, most frequent first
+static std::vector<uint8_t> byCount(const std::array<uint64_t, OP_COUNT> &counts) {
+  std::vector<uint8_t> opcodes;
+  for (int opcode = 0; opcode < OP_COUNT; opcode++)
+    if (counts[opcode] != 0) opcodes.push_back(static_cast<uint8_t>(opcode));
+  std::stable_sort(opcodes.begin(), opcodes.end(),
+                   [&counts](uint8_t a, uint8_t b) { return counts[a] > counts[b]; });
+  return opcodes;
+}
+
+void OpcodeProfiler::writeReport(FILE *out) const {
+  uint64_t total = getTotalCount();
+  fprintf(out, "== opcode profile: %llu instructions, 1 in %d timed ==\n",
+          static_cast<unsigned long long>(total), OPCODE_PROFILE_SAMPLE_PERIOD);
+  fprintf(out, "%-18s %14s %7s %12s\n", "opcode", "count", "%", "avg cycles");
+  for (uint8_t opcode : byCount(counts_)) {
+    double share = total == 0 ? 0 : 100.0 * counts_[opcode] / total;
+    double average = samples_[opcode] == 0 ? 0 : static_cast<double>(cycles_[opcode]) / samples_[opcode];
+    fprintf(out, "%-18s %14llu %6.2f%% %12.1f\n", DebugChunk::opcodeName(opcode),
+            static_cast<unsigned long long>(counts_[opcode]), share, average);
+  }
+
+  fprintf(out, "\n== top opcode pairs ==\n");
+  for (const Pair &pair : topPairs())
+    fprintf(out, "%-18s -> %-18s %14llu\n", DebugChunk::opcodeName(pair.first),
+            DebugChunk::opcodeName(pair.second), static_cast<unsigned long long>(pair.count));
+
+  fprintf(out, "\n== cycles per sample, by class (bucket = cycles up to 2^n) ==\n");
+  for (size_t c = 0; c < histograms_.size(); c++) {
+    const auto &histogram = histograms_[c];
+    size_t last = histogram.size();
+    while (last > 0 && histogram[last - 1] == 0) last--;
+    if (last == 0) continue;
+    fprintf(out, "%-10s", className(static_cast<OpcodeClass>(c)));
+    for (size_t bucket = 0; bucket < last; bucket++)
+      fprintf(out, " %zu:%llu", bucket + 1, static_cast<unsigned long long>(histogram[bucket]));
+    fprintf(out, "\n");
+  }
+}
+
+std::string OpcodeProfiler::toJson() const {
+  std::string json = "{\n  \"sample_period\": " + std::to_string(OPCODE_PROFILE_SAMPLE_PERIOD) +
+                     ",\n  \"total\": " + std::to_string(getTotalCount()) + ",\n  \"opcodes\": [";
+  bool first = true;
+  for (uint8_t opcode : byCount(counts_)) {
+    json += first ? "\n" : ",\n";
+    first = false;
+    json += std::string("    {\"name\": \"") + DebugChunk::opcodeName(opcode) +
+            "\", \"class\": \"" + className(classOf(opcode)) +
+            "\", \"count\": " + std::to_string(counts_[opcode]) +
+            ", \"samples\": " + std::to_string(samples_[opcode]) +
+            ", \"cycles\": " + std::to_string(cycles_[opcode]) + "}";
+  }
+
+  json += "\n  ],\n  \"pairs\": [";
+  first = true;
+  for (const Pair &pair : topPairs()) {
+    json += first ? "\n" : ",\n";
+    first = false;
+    json += std::string("    {\"first\": \"") + DebugChunk::opcodeName(pair.first) +
+            "\", \"second\": \"" + DebugChunk::opcodeName(pair.second) +
+            "\", \"count\": " + std::to_string(pair.count) + "}";
+  }
+
+  json += "\n  ],\n  \"histograms\": {";
+  for (size_t c = 0; c < histograms_.size(); c++) {
+    json += c == 0 ? "\n" : ",\n";
+    json += std::string("    \"") + className(static_cast<OpcodeClass>(c)) + "\": [";
+    for (size_t bucket = 0; bucket < histograms_[c].size(); bucket++) {
+      if (bucket > 0) json += ", ";
+      json += std::to_string(histograms_[c][bucket]);
+    }
+    json += "]";
+  }
+  json += "\n  }\n}\n";
+  return json;
+}
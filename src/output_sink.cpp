@@ -0,0 +1,42 @@
+#include "output_sink.h"
+#include <cerrno>
+#include <unistd.h>
+
+void OutputSink::write(const char *chars, size_t length) {
+  if (lineBuffered_ && memchr(chars, '\n', length) != nullptr) {
+    for (size_t i = 0; i < length; i++) put(chars[i]);
+    return;
+  }
+
+  if (used_ + length > buffer_.size()) {
+    flush();
+    // too big for the buffer anyway, skip the copy
+    if (length >= buffer_.size()) return writeOut(chars, length);
+  }
+  memcpy(buffer_.data() + used_, chars, length);
+  used_ += length;
+}
+
+void OutputSink::flush() {
+  if (used_ == 0) return;
+  size_t used = used_;
+  used_ = 0;
+  writeOut(buffer_.data(), used);
+}
+
+FdOutputSink::FdOutputSink(int fd, size_t capacity)
+    : OutputSink(capacity), fd_(fd) {
+  setLineBuffered(isatty(fd) == 1);
+}
+
+void FdOutputSink::writeOut(const char *chars, size_t length) {
+  while (length > 0) {
+    ssize_t written = ::write(fd_, chars, length);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    chars += written;
+    length -= static_cast<size_t>(written);
+  }
+}
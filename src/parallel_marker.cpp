@@ -0,0 +1,103 @@
+#include "parallel_marker.h"
+
+ParallelMarker::ParallelMarker(unsigned workerCount) {
+  if (workerCount == 0) workerCount = 1;
+  for (unsigned i = 0; i < workerCount; i++)
+    queues_.push_back(std::make_unique<GrayQueue>());
+  // worker 0 is the thread that calls mark()
+  for (unsigned i = 1; i < workerCount; i++)
+    threads_.emplace_back(&ParallelMarker::workerLoop, this, i);
+}
+
+ParallelMarker::~ParallelMarker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  startCondition_.notify_all();
+  for (std::thread &thread : threads_) thread.join();
+}
+
+void ParallelMarker::mark(std::vector<AsasObject*> &grayObjects) {
+  pendingObjects_.store(grayObjects.size(), std::memory_order_relaxed);
+  for (size_t i = 0; i < grayObjects.size(); i++)
+    queues_[i % queues_.size()]->objects.push_back(grayObjects[i]);
+  grayObjects.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finishedWorkers_ = 0;
+    generation_++;
+  }
+  startCondition_.notify_all();
+
+  drain(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  doneCondition_.wait(lock, [this] { return finishedWorkers_ == threads_.size(); });
+}
+
+void ParallelMarker::workerLoop(unsigned index) {
+  unsigned long seenGeneration = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      startCondition_.wait(lock, [&] { return stopping_ || generation_ != seenGeneration; });
+      if (stopping_) return;
+      seenGeneration = generation_;
+    }
+
+    drain(index);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finishedWorkers_++;
+    }
+    doneCondition_.notify_one();
+  }
+}
+
+void ParallelMarker::drain(unsigned index) {
+  AsasObject *object = nullptr;
+  while (pendingObjects_.load(std::memory_order_acquire) != 0) {
+    if (!popGray(index, object) && !stealGray(index, object)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    forEachReference(object, [this, index](AsasObject *ref) {
+      if (ref != nullptr && ref->tryMark()) pushGray(index, ref);
+    });
+    // children are counted before the parent is retired, so the counter
+    // can only reach zero once the whole graph has been traced
+    pendingObjects_.fetch_sub(1, std::memory_order_acq_rel);
+  }
+}
+
+void ParallelMarker::pushGray(unsigned index, AsasObject *object) {
+  pendingObjects_.fetch_add(1, std::memory_order_relaxed);
+  GrayQueue &queue = *queues_[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  queue.objects.push_back(object);
+}
+
+bool ParallelMarker::popGray(unsigned index, AsasObject *&object) {
+  GrayQueue &queue = *queues_[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.objects.empty()) return false;
+  object = queue.objects.back();
+  queue.objects.pop_back();
+  return true;
+}
+
+bool ParallelMarker::stealGray(unsigned thief, AsasObject *&object) {
+  for (size_t i = 1; i < queues_.size(); i++) {
+    GrayQueue &victim = *queues_[(thief + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.objects.empty()) continue;
+    object = victim.objects.front();
+    victim.objects.pop_front();
+    return true;
+  }
+  return false;
+}
@@ -1,13 +1,16 @@
 #include "parse_rule.h"
 #include "compiler.h"
 
-ParseRule ParseRule::rules[] = {
+const ParseRule ParseRule::rules[] = {
   [TOKEN_LEFT_PAREN]    = {&Compiler::grouping, &Compiler::call,   PREC_CALL},
   [TOKEN_RIGHT_PAREN]   = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_LEFT_BRACE]    = {NULL,     NULL,   PREC_NONE}, 
+  [TOKEN_LEFT_BRACE]    = {&Compiler::mapLiteral,     NULL,   PREC_NONE},
   [TOKEN_RIGHT_BRACE]   = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_LEFT_BRACKET]  = {&Compiler::arrayLiteral, &Compiler::index,   PREC_CALL},
+  [TOKEN_RIGHT_BRACKET] = {NULL,     NULL,   PREC_NONE},
   [TOKEN_COMMA]         = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_DOT]           = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_COLON]         = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_DOT]           = {NULL,     &Compiler::dot,   PREC_CALL},
   [TOKEN_MINUS]         = {&Compiler::unary,    &Compiler::binary, PREC_TERM},
   [TOKEN_PLUS]          = {NULL,     &Compiler::binary, PREC_TERM},
   [TOKEN_SEMICOLON]     = {NULL,     NULL,   PREC_NONE},
@@ -34,17 +37,19 @@ ParseRule ParseRule::rules[] = {
   [TOKEN_NIL]           = {&Compiler::literal,     NULL,   PREC_NONE},
   [TOKEN_OR]            = {NULL,     &Compiler::orOperator,   PREC_OR},
   [TOKEN_PRINT]         = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_RESUME]        = {&Compiler::resumeExpression,     NULL,   PREC_NONE},
   [TOKEN_RETURN]        = {NULL,     NULL,   PREC_NONE},
   [TOKEN_SUPER]         = {NULL,     NULL,   PREC_NONE},
   [TOKEN_THIS]          = {NULL,     NULL,   PREC_NONE},
   [TOKEN_TRUE]          = {&Compiler::literal,     NULL,   PREC_NONE},
   [TOKEN_VAR]           = {NULL,     NULL,   PREC_NONE},
   [TOKEN_WHILE]         = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_YIELD]         = {&Compiler::yieldExpression,     NULL,   PREC_NONE},
   [TOKEN_ERROR]         = {NULL,     NULL,   PREC_NONE},
   [TOKEN_EOF]           = {NULL,     NULL,   PREC_NONE},
 };
 
-ParseRule* ParseRule::getRule(TokenType type) {
+const ParseRule* ParseRule::getRule(TokenType type) {
   return &ParseRule::rules[type];
 }
 
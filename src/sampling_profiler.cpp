@@ -0,0 +1,117 @@
+#include "sampling_profiler.h"
+#include <csignal>
+#include <sys/time.h>
+
+std::atomic<SamplingProfiler*> SamplingProfiler::timerOwner_ = nullptr;
+
+SamplingProfiler::SamplingProfiler(Mode mode, uint32_t rate)
+    : mode_(mode), rate_(rate == 0 ? 1 : rate), countdown_(rate_),
+      ring_(std::make_unique<Sample[]>(SAMPLE_RING_SIZE)) {}
+
+void SamplingProfiler::handleSignal(int) {
+  // async-signal-safe: one lock-free load and one store
+  if (SamplingProfiler *profiler = timerOwner_.load(std::memory_order_relaxed))
+    profiler->pending_.store(true, std::memory_order_relaxed);
+}
+
+bool SamplingProfiler::start() {
+  if (running_) return true;
+  if (mode_ == INSTRUCTIONS) {
+    countdown_ = rate_;
+    running_ = true;
+    return true;
+  }
+
+  SamplingProfiler *expected = nullptr;
+  if (!timerOwner_.compare_exchange_strong(expected, this)) return false;
+
+  struct sigaction action = {};
+  action.sa_handler = handleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, nullptr);
+
+  long interval = 1000000L / rate_;
+  if (interval == 0) interval = 1;
+  itimerval timer = {};
+  timer.it_interval.tv_sec = interval / 1000000L;
+  timer.it_interval.tv_usec = interval % 1000000L;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    timerOwner_.store(nullptr);
+    return false;
+  }
+  running_ = true;
+  return true;
+}
+
+void SamplingProfiler::stop() {
+  if (!running_) return;
+  running_ = false;
+  if (mode_ == INSTRUCTIONS) return;
+
+  itimerval timer = {};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  // the handler stays installed: a SIGPROF already in flight must not hit
+  // the default action, which terminates the process
+  timerOwner_.store(nullptr);
+  pending_.store(false, std::memory_order_relaxed);
+}
+
+void SamplingProfiler::capture(const std::vector<CallFrame> &frames) {
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) == SAMPLE_RING_SIZE) {
+    drain();
+    if (head - tail_.load(std::memory_order_acquire) == SAMPLE_RING_SIZE) {
+      droppedCount_++;
+      return;
+    }
+  }
+
+  Sample &sample = ring_[head & (SAMPLE_RING_SIZE - 1)];
+  uint32_t depth = 0;
+  for (auto frame = frames.rbegin(); frame != frames.rend() && depth < SAMPLE_MAX_DEPTH; ++frame) {
+    sample.frames[depth++] = Frame{frame->getFunction(), frame->getCurrentLine()};
+  }
+  sample.depth = depth;
+  head_.store(head + 1, std::memory_order_release);
+}
+
+void SamplingProfiler::drain() {
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  size_t head = head_.load(std::memory_order_acquire);
+  std::string key;
+  for (; tail != head; tail++) {
+    const Sample &sample = ring_[tail & (SAMPLE_RING_SIZE - 1)];
+    key.clear();
+    for (uint32_t i = sample.depth; i-- > 0;) {
+      const Frame &frame = sample.frames[i];
+      if (!key.empty()) key += ';';
+      key += frame.function->getName();
+      if (includeLines_) {
+        key += ':';
+        key += std::to_string(frame.line);
+      }
+    }
+    folded_[key]++;
+    sampleCount_++;
+  }
+  tail_.store(tail, std::memory_order_release);
+}
+
+std::string SamplingProfiler::toFolded() {
+  drain();
+  std::string out;
+  for (const auto &[stack, count] : folded_) {
+    out += stack;
+    out += ' ';
+    out += std::to_string(count);
+    out += '\n';
+  }
+  return out;
+}
+
+void SamplingProfiler::writeFolded(FILE *out) {
+  std::string folded = toFolded();
+  fwrite(folded.data(), 1, folded.size(), out);
+}
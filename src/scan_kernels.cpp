@@ -0,0 +1,202 @@
+#include "scan_kernels.h"
+#include <cstdint>
+#include <initializer_list>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ASAS_X86 1
+#endif
+
+static inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+static inline bool isDigitChar(char c) { return c >= '0' && c <= '9'; }
+static inline bool isIdentifierChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || isDigitChar(c) || c == '_';
+}
+
+// Scalar versions: the fallback, and the tail of the vector ones.
+
+static const char *scalarSkipBlanks(const char *p, const char *end, int *line) {
+  for (; p != end && isBlank(*p); p++)
+    if (*p == '\n') (*line)++;
+  return p;
+}
+
+static const char *scalarSkipIdentifier(const char *p, const char *end) {
+  while (p != end && isIdentifierChar(*p)) p++;
+  return p;
+}
+
+static const char *scalarSkipDigits(const char *p, const char *end) {
+  while (p != end && isDigitChar(*p)) p++;
+  return p;
+}
+
+static const char *scalarFindQuote(const char *p, const char *end, int *line) {
+  for (; p != end && *p != '"'; p++)
+    if (*p == '\n') (*line)++;
+  return p;
+}
+
+static const char *scalarFindNewline(const char *p, const char *end) {
+  while (p != end && *p != '\n') p++;
+  return p;
+}
+
+static const ScanKernels SCALAR_KERNELS = {
+  "scalar", scalarSkipBlanks, scalarSkipIdentifier, scalarSkipDigits, scalarFindQuote, scalarFindNewline,
+};
+
+#ifdef ASAS_X86
+
+#define ASAS_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define ASAS_AVX2 __attribute__((target("avx2,popcnt")))
+
+// the bits below the lowest set one
+static inline uint32_t bitsBeforeFirst(uint32_t mask) { return (mask & (0u - mask)) - 1; }
+
+// pcmpestri classifies a whole block against a set of bytes or of byte
+// ranges (`set`, `setLength` bytes of it) and returns the index of the
+// first byte that ends the run, 16 if none does. With `line`, the newlines
+// before that byte are added to it. p moves to the end of the run, or to
+// the tail when less than a block is left; the return value says which.
+template<int MODE>
+ASAS_SSE42 static inline bool sse42Scan(const char *&p, const char *end, __m128i set, int setLength, int *line) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int index = _mm_cmpestri(set, setLength, block, 16, MODE);
+    if (line != nullptr) {
+      uint32_t newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+      *line += _mm_popcnt_u32(index == 16 ? newlines : newlines & ((1u << index) - 1));
+    }
+    if (index < 16) {
+      p += index;
+      return true;
+    }
+  }
+  return false;
+}
+
+// the first byte outside the set ends a run; the first one inside it ends a search
+#define SSE42_SKIP (_SIDD_UBYTE_OPS | _SIDD_NEGATIVE_POLARITY)
+#define SSE42_FIND (_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY)
+
+ASAS_SSE42 static const char *sse42SkipBlanks(const char *p, const char *end, int *line) {
+  const __m128i blanks = _mm_setr_epi8(' ', '\t', '\r', '\n', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  return sse42Scan<SSE42_SKIP | _SIDD_CMP_EQUAL_ANY>(p, end, blanks, 4, line)
+      ? p : scalarSkipBlanks(p, end, line);
+}
+
+ASAS_SSE42 static const char *sse42SkipIdentifier(const char *p, const char *end) {
+  const __m128i ranges = _mm_setr_epi8('a', 'z', 'A', 'Z', '0', '9', '_', '_', 0, 0, 0, 0, 0, 0, 0, 0);
+  return sse42Scan<SSE42_SKIP | _SIDD_CMP_RANGES>(p, end, ranges, 8, nullptr)
+      ? p : scalarSkipIdentifier(p, end);
+}
+
+ASAS_SSE42 static const char *sse42SkipDigits(const char *p, const char *end) {
+  const __m128i ranges = _mm_setr_epi8('0', '9', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  return sse42Scan<SSE42_SKIP | _SIDD_CMP_RANGES>(p, end, ranges, 2, nullptr)
+      ? p : scalarSkipDigits(p, end);
+}
+
+ASAS_SSE42 static const char *sse42FindQuote(const char *p, const char *end, int *line) {
+  return sse42Scan<SSE42_FIND>(p, end, _mm_set1_epi8('"'), 1, line) ? p : scalarFindQuote(p, end, line);
+}
+
+ASAS_SSE42 static const char *sse42FindNewline(const char *p, const char *end) {
+  return sse42Scan<SSE42_FIND>(p, end, _mm_set1_epi8('\n'), 1, nullptr) ? p : scalarFindNewline(p, end);
+}
+
+static const ScanKernels SSE42_KERNELS = {
+  "sse4.2", sse42SkipBlanks, sse42SkipIdentifier, sse42SkipDigits, sse42FindQuote, sse42FindNewline,
+};
+
+// Same contract as sse42Scan, 32 bytes at a time; stops(block) is the mask
+// of the bytes that end the run.
+template<typename Stops>
+ASAS_AVX2 static inline bool avx2Scan(const char *&p, const char *end, int *line, Stops stops) {
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    uint32_t mask = stops(block);
+    if (line != nullptr) {
+      uint32_t newlines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+      *line += _mm_popcnt_u32(mask == 0 ? newlines : newlines & bitsBeforeFirst(mask));
+    }
+    if (mask != 0) {
+      p += __builtin_ctz(mask);
+      return true;
+    }
+  }
+  return false;
+}
+
+ASAS_AVX2 static inline uint32_t avx2Equal(__m256i block, char c) {
+  return _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(c)));
+}
+
+// bytes in [first, last]; ASCII only, the bytes >= 0x80 compare as negative
+ASAS_AVX2 static inline __m256i avx2InRange(__m256i block, char first, char last) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8(first - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(last + 1), block));
+}
+
+ASAS_AVX2 static const char *avx2SkipBlanks(const char *p, const char *end, int *line) {
+  bool found = avx2Scan(p, end, line, [](__m256i block) ASAS_AVX2 {
+    return ~(avx2Equal(block, ' ') | avx2Equal(block, '\t') | avx2Equal(block, '\r') | avx2Equal(block, '\n'));
+  });
+  return found ? p : scalarSkipBlanks(p, end, line);
+}
+
+ASAS_AVX2 static const char *avx2SkipIdentifier(const char *p, const char *end) {
+  bool found = avx2Scan(p, end, nullptr, [](__m256i block) ASAS_AVX2 {
+    __m256i lower = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+    __m256i identifier = _mm256_or_si256(
+        _mm256_or_si256(avx2InRange(lower, 'a', 'z'), avx2InRange(block, '0', '9')),
+        _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')));
+    return ~static_cast<uint32_t>(_mm256_movemask_epi8(identifier));
+  });
+  return found ? p : scalarSkipIdentifier(p, end);
+}
+
+ASAS_AVX2 static const char *avx2SkipDigits(const char *p, const char *end) {
+  bool found = avx2Scan(p, end, nullptr, [](__m256i block) ASAS_AVX2 {
+    return ~static_cast<uint32_t>(_mm256_movemask_epi8(avx2InRange(block, '0', '9')));
+  });
+  return found ? p : scalarSkipDigits(p, end);
+}
+
+ASAS_AVX2 static const char *avx2FindQuote(const char *p, const char *end, int *line) {
+  bool found = avx2Scan(p, end, line, [](__m256i block) ASAS_AVX2 { return avx2Equal(block, '"'); });
+  return found ? p : scalarFindQuote(p, end, line);
+}
+
+ASAS_AVX2 static const char *avx2FindNewline(const char *p, const char *end) {
+  bool found = avx2Scan(p, end, nullptr, [](__m256i block) ASAS_AVX2 { return avx2Equal(block, '\n'); });
+  return found ? p : scalarFindNewline(p, end);
+}
+
+static const ScanKernels AVX2_KERNELS = {
+  "avx2", avx2SkipBlanks, avx2SkipIdentifier, avx2SkipDigits, avx2FindQuote, avx2FindNewline,
+};
+
+#endif // ASAS_X86
+
+const ScanKernels *scanKernelsFor(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::SCALAR: return &SCALAR_KERNELS;
+#ifdef ASAS_X86
+    case SimdLevel::SSE4_2:
+      return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt") ? &SSE42_KERNELS : nullptr;
+    case SimdLevel::AVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") ? &AVX2_KERNELS : nullptr;
+#endif
+    default: return nullptr;
+  }
+}
+
+const ScanKernels &scanKernels() {
+  static const ScanKernels *selected = []() {
+    for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::SSE4_2})
+      if (const ScanKernels *kernels = scanKernelsFor(level)) return kernels;
+    return &SCALAR_KERNELS;
+  }();
+  return *selected;
+}
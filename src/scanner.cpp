@@ -1,5 +1,85 @@
 #include "scanner.h"
+#include <array>
 #include <string.h>
+#include <string_view>
+
+// Keywords are found with a perfect hash over (length, first char, last
+// char): one table slot per keyword, so an identifier costs one hash and at
+// most one compare. The multipliers are searched at compile time; a new
+// keyword only needs a line in KEYWORDS, and the static_assert below fires
+// if no multipliers separate them in KEYWORD_TABLE_SIZE slots.
+struct Keyword {
+  std::string_view text;
+  TokenType type;
+};
+
+static constexpr Keyword KEYWORDS[] = {
+    {"and", TOKEN_AND},       {"class", TOKEN_CLASS},   {"else", TOKEN_ELSE},
+    {"false", TOKEN_FALSE},   {"for", TOKEN_FOR},       {"func", TOKEN_FUNC},
+    {"if", TOKEN_IF},         {"nil", TOKEN_NIL},       {"or", TOKEN_OR},
+    {"print", TOKEN_PRINT},   {"resume", TOKEN_RESUME}, {"return", TOKEN_RETURN},
+    {"super", TOKEN_SUPER},   {"this", TOKEN_THIS},     {"true", TOKEN_TRUE},
+    {"var", TOKEN_VAR},       {"while", TOKEN_WHILE},   {"yield", TOKEN_YIELD},
+};
+
+// a power of two, so the slot is a mask
+#define KEYWORD_TABLE_SIZE 32
+
+struct KeywordHash {
+  unsigned firstFactor;
+  unsigned lastFactor;
+};
+
+static constexpr unsigned keywordSlot(int length, char first, char last, KeywordHash hash) {
+  return ((unsigned char)first * hash.firstFactor + (unsigned char)last * hash.lastFactor +
+          (unsigned)length) & (KEYWORD_TABLE_SIZE - 1);
+}
+
+static constexpr bool separatesKeywords(KeywordHash hash) {
+  bool used[KEYWORD_TABLE_SIZE] = {};
+  for (const Keyword &keyword : KEYWORDS) {
+    unsigned slot = keywordSlot((int)keyword.text.size(), keyword.text.front(), keyword.text.back(), hash);
+    if (used[slot])
+      return false;
+    used[slot] = true;
+  }
+  return true;
+}
+
+static constexpr KeywordHash findKeywordHash() {
+  for (unsigned lastFactor = 1; lastFactor < 64; lastFactor++)
+    for (unsigned firstFactor = 1; firstFactor < 64; firstFactor++)
+      if (separatesKeywords({firstFactor, lastFactor}))
+        return {firstFactor, lastFactor};
+  return {0, 0};
+}
+
+static constexpr KeywordHash KEYWORD_HASH = findKeywordHash();
+static_assert(KEYWORD_HASH.firstFactor != 0,
+              "no perfect keyword hash: grow KEYWORD_TABLE_SIZE or the search");
+
+static constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> buildKeywordTable() {
+  std::array<Keyword, KEYWORD_TABLE_SIZE> table = {}; // empty slots never match
+  for (const Keyword &keyword : KEYWORDS)
+    table[keywordSlot((int)keyword.text.size(), keyword.text.front(), keyword.text.back(),
+                      KEYWORD_HASH)] = keyword;
+  return table;
+}
+
+static constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> KEYWORD_TABLE = buildKeywordTable();
+
+static constexpr int keywordLength(bool longest) {
+  int result = longest ? 0 : 1 << 30;
+  for (const Keyword &keyword : KEYWORDS) {
+    int length = (int)keyword.text.size();
+    if (longest ? length > result : length < result)
+      result = length;
+  }
+  return result;
+}
+
+static constexpr int KEYWORD_MIN_LENGTH = keywordLength(false);
+static constexpr int KEYWORD_MAX_LENGTH = keywordLength(true);
 
 Token Scanner::scanToken() {
   skipWhitespace();
@@ -23,10 +103,16 @@ Token Scanner::scanToken() {
     return makeToken(TOKEN_LEFT_BRACE);
   case '}':
     return makeToken(TOKEN_RIGHT_BRACE);
+  case '[':
+    return makeToken(TOKEN_LEFT_BRACKET);
+  case ']':
+    return makeToken(TOKEN_RIGHT_BRACKET);
   case ';':
     return makeToken(TOKEN_SEMICOLON);
   case ',':
     return makeToken(TOKEN_COMMA);
+  case ':':
+    return makeToken(TOKEN_COLON);
   case '.':
     return makeToken(TOKEN_DOT);
   case '-':
@@ -57,7 +143,11 @@ Token Scanner::scanToken() {
 }
 
 Token Scanner::string() {
-  while (peek() != '"' && !isAtEnd()) {
+  for (int i = 0; peek() != '"' && !isAtEnd(); i++) {
+    if (i == SCAN_INLINE_BYTES) {
+      current_ = kernels_->findQuote(current_, end_, &line_);
+      break;
+    }
     if (peek() == '\n')
       line_++;
     nextChar();
@@ -72,83 +162,39 @@ Token Scanner::string() {
 }
 
 Token Scanner::number() {
-  while (isDigit(peek()))
-    nextChar();
+  skipDigits();
 
   // Look for a fractional part.
   if (peek() == '.' && isDigit(peekNext())) {
     // Consume the "."
     nextChar();
 
-    while (isDigit(peek()))
-      nextChar();
+    skipDigits();
   }
 
   return makeToken(TOKEN_NUMBER);
 }
 
 Token Scanner::identifier() {
-  while (isAlpha(peek()) || isDigit(peek()))
+  for (int i = 0; isAlpha(peek()) || isDigit(peek()); i++) {
+    if (i == SCAN_INLINE_BYTES) {
+      current_ = kernels_->skipIdentifier(current_, end_);
+      break;
+    }
     nextChar();
+  }
   return makeToken(identifierType());
 }
 
 TokenType Scanner::identifierType() {
-  switch (*start_) {
-  case 'a':
-    return checkKeyword(1, 2, "nd", TOKEN_AND);
-  case 'c':
-    return checkKeyword(1, 4, "lass", TOKEN_CLASS);
-  case 'e':
-    return checkKeyword(1, 3, "lse", TOKEN_ELSE);
-  case 'f':
-    if (current_ - start_ > 1) {
-      switch (*(start_ + 1)) {
-      case 'a':
-        return checkKeyword(2, 3, "lse", TOKEN_FALSE);
-      case 'o':
-        return checkKeyword(2, 1, "r", TOKEN_FOR);
-      case 'u':
-        return checkKeyword(2, 2, "nc", TOKEN_FUNC);
-      }
-    }
-    break;
-  case 'i':
-    return checkKeyword(1, 1, "f", TOKEN_IF);
-  case 'n':
-    return checkKeyword(1, 2, "il", TOKEN_NIL);
-  case 'o':
-    return checkKeyword(1, 1, "r", TOKEN_OR);
-  case 'p':
-    return checkKeyword(1, 4, "rint", TOKEN_PRINT);
-  case 'r':
-    return checkKeyword(1, 5, "eturn", TOKEN_RETURN);
-  case 's':
-    return checkKeyword(1, 4, "uper", TOKEN_SUPER);
-  case 't':
-    if (current_ - start_ > 1) {
-      switch (*(start_ + 1)) {
-      case 'h':
-        return checkKeyword(2, 2, "is", TOKEN_THIS);
-      case 'r':
-        return checkKeyword(2, 2, "ue", TOKEN_TRUE);
-      }
-    }
-    break;
-  case 'v':
-    return checkKeyword(1, 2, "ar", TOKEN_VAR);
-  case 'w':
-    return checkKeyword(1, 4, "hile", TOKEN_WHILE);
-  }
-  return TOKEN_IDENTIFIER;
-}
-
-TokenType Scanner::checkKeyword(int start, int length, const char *rest,
-                                TokenType type) {
-  if (current_ - this->start_ == start + length &&
-      memcmp(this->start_ + start, rest, length) == 0) {
-    return type;
-  }
+  int length = (int)(current_ - start_);
+  if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH)
+    return TOKEN_IDENTIFIER;
+  const Keyword &keyword =
+      KEYWORD_TABLE[keywordSlot(length, start_[0], start_[length - 1], KEYWORD_HASH)];
+  if (keyword.text.size() == (size_t)length &&
+      memcmp(start_, keyword.text.data(), length) == 0)
+    return keyword.type;
   return TOKEN_IDENTIFIER;
 }
 
@@ -160,10 +206,23 @@ Token Scanner::errorToken(const char *message) {
   return Token(TOKEN_ERROR, message, (int)strlen(message), line_);
 }
 
+void Scanner::skipDigits() {
+  for (int i = 0; isDigit(peek()); i++) {
+    if (i == SCAN_INLINE_BYTES) {
+      current_ = kernels_->skipDigits(current_, end_);
+      return;
+    }
+    nextChar();
+  }
+}
+
 void Scanner::skipWhitespace() {
-  for (;;) {
-    char c = peek();
-    switch (c) {
+  for (int i = 0;; i++) {
+    if (i == SCAN_INLINE_BYTES) {
+      current_ = kernels_->skipBlanks(current_, end_, &line_);
+      i = 0;
+    }
+    switch (peek()) {
     case ' ':
     case '\r':
     case '\t':
@@ -174,13 +233,10 @@ void Scanner::skipWhitespace() {
       nextChar();
       break;
     case '/':
-      if (peekNext() == '/') {
-        // A comment goes until the end of the line.
-        while (peek() != '\n' && !isAtEnd())
-          nextChar();
-      } else {
+      if (peekNext() != '/')
         return;
-      }
+      // A comment goes until the end of the line.
+      current_ = kernels_->findNewline(current_ + 2, end_);
       break;
     default:
       return;
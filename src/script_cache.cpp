@@ -0,0 +1,52 @@
+#include "script_cache.h"
+#include <cstring>
+
+uint64_t ScriptCache::hashSource(const char *source, size_t length) {
+  // 64-bit FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= static_cast<uint8_t>(source[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+AsasFunction *ScriptCache::lookup(const char *source, size_t length) {
+  auto it = index_.find(hashSource(source, length));
+  if (it == index_.end() || it->second->source.size() != length ||
+      memcmp(it->second->source.data(), source, length) != 0) {
+    misses_++;
+    return nullptr;
+  }
+
+  hits_++;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->function;
+}
+
+void ScriptCache::insert(const char *source, size_t length, AsasFunction *function) {
+  if (capacity_ == 0) return;
+
+  uint64_t hash = hashSource(source, length);
+  auto it = index_.find(hash);
+  if (it != index_.end()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+
+  evictTo(capacity_ - 1);
+  entries_.push_front(Entry{hash, std::string(source, length), function});
+  index_[hash] = entries_.begin();
+}
+
+void ScriptCache::setCapacity(size_t capacity) {
+  capacity_ = capacity;
+  evictTo(capacity_);
+}
+
+void ScriptCache::evictTo(size_t capacity) {
+  while (entries_.size() > capacity) {
+    index_.erase(entries_.back().hash);
+    entries_.pop_back();
+  }
+}
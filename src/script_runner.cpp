@@ -0,0 +1,66 @@
+#include "script_runner.h"
+#include <thread>
+
+ScriptRunner::ScriptRunner(unsigned workerCount) : workerCount_(workerCount) {
+  if (workerCount_ == 0) workerCount_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::vector<ScriptResult> ScriptRunner::runAll(const std::vector<std::string> &sources) {
+  std::vector<ScriptResult> results(sources.size());
+  unsigned threadCount = std::min<size_t>(workerCount_, sources.size());
+  if (threadCount == 0) return results;
+
+  queues_.clear();
+  for (unsigned i = 0; i < threadCount; i++) queues_.push_back(std::make_unique<JobQueue>());
+  for (size_t job = 0; job < sources.size(); job++)
+    queues_[job % threadCount]->jobs.push_back(job);
+
+  auto work = [&](unsigned worker) {
+    Isolate isolate;
+    IsolateScope isolateScope(isolate);
+    auto sink = std::make_unique<MemoryOutputSink>();
+    MemoryOutputSink *output = sink.get();
+    VM vm(isolate);
+    vm.setOutputSink(std::move(sink));
+
+    size_t job;
+    while (popJob(worker, job) || stealJob(worker, job)) {
+      AsasFunction *script = registry_.getOrCompile(sources[job]);
+      results[job].status = script != nullptr ? vm.execute(script) : INTERPRET_COMPILE_ERROR;
+      results[job].output = output->getContents();
+      output->clear();
+      vm.reset();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount - 1);
+  for (unsigned i = 1; i < threadCount; i++) threads.emplace_back(work, i);
+  // the calling thread is worker 0
+  work(0);
+  for (std::thread &thread : threads) thread.join();
+  return results;
+}
+
+bool ScriptRunner::popJob(unsigned worker, size_t &job) {
+  JobQueue &queue = *queues_[worker];
+  std::lock_guard lock(queue.mutex);
+  if (queue.jobs.empty()) return false;
+  job = queue.jobs.front();
+  queue.jobs.pop_front();
+  return true;
+}
+
+// No job ever spawns another, so once every deque has been found empty
+// there is nothing left to steal.
+bool ScriptRunner::stealJob(unsigned thief, size_t &job) {
+  for (size_t i = 1; i < queues_.size(); i++) {
+    JobQueue &victim = *queues_[(thief + i) % queues_.size()];
+    std::lock_guard lock(victim.mutex);
+    if (victim.jobs.empty()) continue;
+    job = victim.jobs.back();
+    victim.jobs.pop_back();
+    return true;
+  }
+  return false;
+}
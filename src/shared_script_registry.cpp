@@ -0,0 +1,59 @@
+#include "shared_script_registry.h"
+#include <mutex>
+#include <unordered_set>
+#include "compiler.h"
+#include "object.h"
+#include "parallel_marker.h"
+
+SharedScriptRegistry::~SharedScriptRegistry() {
+  IsolateScope isolateScope(isolate_);
+  for (AsasObject *object : objects_) delete object;
+}
+
+AsasFunction *SharedScriptRegistry::getOrCompile(const std::string &source) {
+  {
+    std::shared_lock lock(mutex_);
+    auto it = scripts_.find(source);
+    if (it != scripts_.end()) return it->second;
+  }
+
+  // compile outside the lock, a racing duplicate is thrown away below
+  IsolateScope isolateScope(isolate_);
+  AsasString *scriptName = AsasString::create("<script>", 8);
+  Compiler compiler(source.c_str(), scriptName, FunctionType::SCRIPT);
+  AsasFunction *function = compiler.compile();
+  if (function == nullptr) {
+    // a failed compile frees its functions but not the name it was given
+    delete scriptName;
+    return nullptr;
+  }
+
+  std::vector<AsasObject*> objects;
+  collectObjects(function, objects);
+
+  std::unique_lock lock(mutex_);
+  auto [it, inserted] = scripts_.try_emplace(source, function);
+  if (!inserted) {
+    lock.unlock();
+    for (AsasObject *object : objects) delete object;
+    return it->second;
+  }
+  for (AsasObject *object : objects) object->setShared();
+  objects_.insert(objects_.end(), objects.begin(), objects.end());
+  return function;
+}
+
+size_t SharedScriptRegistry::size() const {
+  std::shared_lock lock(mutex_);
+  return scripts_.size();
+}
+
+void SharedScriptRegistry::collectObjects(AsasObject *root, std::vector<AsasObject*> &objects) {
+  std::unordered_set<AsasObject*> seen{root};
+  objects.push_back(root);
+  for (size_t i = 0; i < objects.size(); i++) {
+    forEachReference(objects[i], [&](AsasObject *ref) {
+      if (ref != nullptr && seen.insert(ref).second) objects.push_back(ref);
+    });
+  }
+}
@@ -0,0 +1,59 @@
+#include "source_file.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool SourceFile::open(const std::string &path, std::string &error) {
+  close();
+  int fd;
+  do fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    error = strerror(errno);
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      // the scanner reads it front to back, once
+      madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+      ::close(fd);
+      data_ = static_cast<const char*>(mapping);
+      size_ = static_cast<size_t>(info.st_size);
+      mapped_ = true;
+      return true;
+    }
+  }
+
+  // not mappable: read it through
+  char chunk[64 * 1024];
+  for (;;) {
+    ssize_t count = ::read(fd, chunk, sizeof(chunk));
+    if (count == 0) break;
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      error = strerror(errno);
+      ::close(fd);
+      buffer_.clear();
+      return false;
+    }
+    buffer_.append(chunk, static_cast<size_t>(count));
+  }
+  ::close(fd);
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+  return true;
+}
+
+void SourceFile::close() {
+  if (mapped_) munmap(const_cast<char*>(data_), size_);
+  buffer_.clear();
+  data_ = "";
+  size_ = 0;
+  mapped_ = false;
+}
@@ -1,5 +1,10 @@
 #include "value.h"
 #include "object.h"
+#include "fiber.h"
+#include "asas_map.h"
+#include "float64_array.h"
+#include "output_sink.h"
+#include <charconv>
 
 AsasString* ValueHelper::toStringObj(const Value &value) {
   if (auto objPtr = std::get_if<AsasObject*>(&value)) {
@@ -57,35 +62,113 @@ AsasString* ValueHelper::tryParseToStringObj(const Value &value) {
 // }
 
 
-void printValue(const Value &value) {
-  std::visit([](auto &&v) {
+int formatNumber(char *buffer, double number) {
+  std::to_chars_result result =
+      std::to_chars(buffer, buffer + NUMBER_BUFFER_SIZE, number, std::chars_format::fixed, 2);
+  return static_cast<int>(result.ptr - buffer);
+}
+
+// Produces the text of a value piece by piece through write(chars, length),
+// so stdio and OutputSink printing share one formatting path. `enclosing`
+// holds the arrays and maps being printed around this value, so a container
+// that holds itself prints as [...] or {...} instead of recursing forever.
+template<typename Write>
+static void writeValue(const Value &value, Write &&write,
+                       std::vector<const AsasObject*> *enclosing = nullptr) {
+  auto writeText = [&write](const char *text) { write(text, strlen(text)); };
+  auto writeName = [&](const char *prefix, const std::string &name) {
+    writeText(prefix);
+    write(name.data(), name.size());
+    writeText(">");
+  };
+
+  std::visit([&](auto &&v) {
     using V = std::decay_t<decltype(v)>;
 
     if constexpr (std::is_same_v<V, std::monostate>)
-      printf("nil");
+      writeText("nil");
     else if constexpr (std::is_same_v<V, bool>)
-      printf("%s", v ? "true" : "false");
-    else if constexpr (std::is_same_v<V, double>)
-      printf("%.2f", v);
+      writeText(v ? "true" : "false");
+    else if constexpr (std::is_same_v<V, double>) {
+      char number[NUMBER_BUFFER_SIZE];
+      write(number, formatNumber(number, v));
+    }
     else if constexpr (std::is_same_v<V, AsasObject*>) {
-      if (!v) return void (printf("nil"));
+      if (!v) return writeText("nil");
 
       if (auto str = dynamic_cast<AsasString*>(v))
-        printf("%s", str->getData());
+        write(str->getData(), str->getLength());
+      else if (auto rope = dynamic_cast<AsasRope*>(v))
+        rope->forEachPiece([&write](const char *chars, int length) { write(chars, length); });
       else if (auto func = dynamic_cast<AsasFunction*>(v))
-        printf("<fn %s>", func->getName().c_str());
+        writeName("<fn ", func->getName());
       else if (auto nativeFn = dynamic_cast<AsasNativeFunction*>(v))
-        printf("<native fn %s>", nativeFn->getName().c_str());
+        writeName("<native fn ", nativeFn->getName());
       else if (auto closure = dynamic_cast<AsasClosure*>(v))
-        printf("<closure %s>", closure->getFunction()->getName().c_str());
+        writeName("<closure ", closure->getFunction()->getName());
+      else if (dynamic_cast<AsasFiber*>(v))
+        writeText("<fiber>");
+      else if (auto array = dynamic_cast<AsasArray*>(v)) {
+        std::vector<const AsasObject*> outermost;
+        std::vector<const AsasObject*> &path = enclosing != nullptr ? *enclosing : outermost;
+        if (std::find(path.begin(), path.end(), array) != path.end())
+          return writeText("[...]");
+        path.push_back(array);
+        writeText("[");
+        for (size_t i = 0; i < array->size(); i++) {
+          if (i > 0) writeText(", ");
+          writeValue(array->at(i), write, &path);
+        }
+        writeText("]");
+        path.pop_back();
+      }
+      else if (auto numbers = dynamic_cast<AsasFloat64Array*>(v)) {
+        writeText("Float64Array[");
+        for (size_t i = 0; i < numbers->size(); i++) {
+          if (i > 0) writeText(", ");
+          char number[NUMBER_BUFFER_SIZE];
+          write(number, formatNumber(number, numbers->at(i)));
+        }
+        writeText("]");
+      }
+      else if (auto map = dynamic_cast<AsasMap*>(v)) {
+        std::vector<const AsasObject*> outermost;
+        std::vector<const AsasObject*> &path = enclosing != nullptr ? *enclosing : outermost;
+        if (std::find(path.begin(), path.end(), map) != path.end())
+          return writeText("{...}");
+        path.push_back(map);
+        writeText("{");
+        bool first = true;
+        map->forEach([&](const Value &key, const Value &entry) {
+          if (!first) writeText(", ");
+          first = false;
+          writeValue(key, write, &path);
+          writeText(": ");
+          writeValue(entry, write, &path);
+        });
+        writeText("}");
+        path.pop_back();
+      }
       else
-        printf("<unknown object>");
+        writeText("<unknown object>");
     }
     else
       throw std::runtime_error("Unknown type in Value variant");
   }, value);
 }
 
+void printValue(const Value &value) {
+  writeValue(value, [](const char *chars, size_t length) {
+    fwrite(chars, 1, length, stdout);
+  });
+}
+
+void printValue(OutputSink &out, const Value &value) {
+  writeValue(value, [&out](const char *chars, size_t length) {
+    out.write(chars, length);
+  });
+}
+
 void printValue(const char* left, const Value &value, const char* right) {
   printf("%s", left);
   printValue(value);
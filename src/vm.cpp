@@ -3,35 +3,128 @@
 #include "debug.h"
 #include "compiler.h"
 #include <cstdarg>
+#include <cstring>
 
 InterpretResult VM::interpret(const char *source) {
-  AsasString *scriptName = allocateObject<AsasString>("<script>");
-  Compiler compiler(source, scriptName, FunctionType::SCRIPT);
+  return interpret(source, strlen(source));
+}
+
+InterpretResult VM::interpret(const char *source, size_t length) {
+  AsasFunction* function = compile(source, length);
+  if (function == nullptr)
+    return INTERPRET_COMPILE_ERROR;
+  return execute(function);
+}
+
+AsasFunction* VM::compile(const char *source) {
+  return compile(source, strlen(source));
+}
+
+AsasFunction* VM::compile(const char *source, size_t length) {
+  IsolateScope isolateScope(isolate_);
+  if (AsasFunction* cached = scriptCache_.lookup(source, length))
+    return cached;
+
+  AsasString *scriptName = allocateString("<script>", 8);
+  Compiler compiler(source, length, scriptName, FunctionType::SCRIPT);
   // AsasFunction* function = traceObject(compiler.compile());
   AsasFunction* function = compiler.compile();
   if (function == nullptr)
-    return INTERPRET_COMPILE_ERROR;
+    return nullptr;
+
+  setupGarbageCollector(function);
+  scriptCache_.insert(source, length, function);
+  return function;
+}
 
-  AsasClosure* closure = new AsasClosure(function);
+InterpretResult VM::execute(AsasFunction *script) {
+  IsolateScope isolateScope(isolate_);
+  AsasClosure* closure = new AsasClosure(script);
   setupGarbageCollector(closure);
   push(closure);
   callFrames_.push_back(CallFrame{closure, 0});
   // DebugChunk::disassembleChunk(*function->getChunk(), "code");
 
+  InterpretResult result = run();
+  // then whatever the script spawned, until no task can make progress
+  if (result == INTERPRET_OK) result = runEventLoop();
+  output_->flush();
+  return result;
+}
+
+InterpretResult VM::callFunction(const std::string &name, const std::vector<Value> &args,
+                                 Value *result) {
+  IsolateScope isolateScope(isolate_);
+  auto global = globals_.find(name);
+  if (global == globals_.end()) {
+    runtimeError("Undefined function '%s'.", name.c_str());
+    return INTERPRET_RUNTIME_ERROR;
+  }
+
+  size_t baseFrameCount = callFrames_.size();
+  push(global->second);
+  for (const Value &arg : args) push(arg);
+  if (!callValue(global->second, static_cast<int>(args.size()))) {
+    resetStack();
+    return INTERPRET_RUNTIME_ERROR;
+  }
+
+  InterpretResult status = INTERPRET_OK;
+  if (callFrames_.size() == baseFrameCount) {
+    // native function, its result is already on the stack
+    Value value = pop();
+    if (result != nullptr) *result = value;
+  } else {
+    status = run(baseFrameCount, result);
+  }
+  output_->flush();
+  return status;
+}
+
+bool VM::getGlobal(const std::string &name, Value &value) const {
+  auto global = globals_.find(name);
+  if (global == globals_.end()) return false;
+  value = global->second;
+  return true;
+}
+
+Value VM::makeString(const std::string &text) {
+  IsolateScope isolateScope(isolate_);
+  AsasString* string = allocateString(text.data(), static_cast<int>(text.size()));
+  pinnedObjects_.push_back(string);
+  return string;
+}
+
+void VM::reset() {
+  IsolateScope isolateScope(isolate_);
+  resetStack();
+  globals_.clear();
+  pinnedObjects_.clear();
   defineNativeFunctions();
-  
-  return run();
 }
 
-InterpretResult VM::run() {
+InterpretResult VM::run(size_t baseFrameCount, Value *returnValue) {
+#ifdef DEBUG_PROFILE_OPCODES
+  profiler_.interrupt();
+#endif
 
   for (;;) {
+    // runtimeError unwinds every frame
+    if (callFrames_.empty()) {
+      stack_.clear();
+      return INTERPRET_RUNTIME_ERROR;
+    }
     CallFrame *frame = &callFrames_.back();
 #ifdef DEBUG_TRACE_EXECUTION
     debugVM();
 #endif
-    uint8_t instruction;
-    switch (instruction = frame->readByte()) {
+    uint8_t instruction = frame->readByte();
+#ifdef DEBUG_PROFILE_OPCODES
+    profiler_.instruction(instruction);
+#endif
+    // after the read, so the sampled line is the instruction's own
+    if (sampler_ != nullptr && sampler_->shouldSample()) sampler_->capture(callFrames_);
+    switch (instruction) {
     case OP_CONSTANT: push(frame->readConstant()); break;
     case OP_NIL: push(std::monostate{}); break;
     case OP_TRUE: push(true); break;
@@ -65,7 +158,7 @@ InterpretResult VM::run() {
       // const char *variableName = ValueHelper::toStringObj(constant)->getData();
       AsasString* variableName = ValueHelper::toStringObj(constant);
       if (!globals_.contains(variableName->getData())) {
-        runtimeError("Undefined variable '%s'.", variableName);
+        runtimeError("Undefined variable '%s'.", variableName->getData());
         return INTERPRET_RUNTIME_ERROR;
       }
       globals_[variableName->getData()] = peek();
@@ -101,7 +194,11 @@ InterpretResult VM::run() {
     case OP_DIVIDE: opDivide(); break;
     case OP_NOT: opNot(); break;
     case OP_NEGATE: opNegate(); break;
-    case OP_PRINT: printValue("-> ", pop(), "\n"); break;
+    case OP_PRINT:
+      output_->write("-> ", 3);
+      printValue(*output_, pop());
+      output_->put('\n');
+      break;
     case OP_JUMP: {
       uint16_t offset = frame->readShort();
       frame->incrementIP(offset);
@@ -124,6 +221,8 @@ InterpretResult VM::run() {
         runtimeError("Failed to call function.");
         return INTERPRET_RUNTIME_ERROR;
       }
+      // an async native may have put the running fiber to wait
+      if (backAtBase(baseFrameCount)) return INTERPRET_OK;
       break;
     }
     case OP_CLOSURE: {
@@ -158,15 +257,35 @@ InterpretResult VM::run() {
       pop();
       break;
     }
+    case OP_ARRAY: opArray(frame->readByte()); break;
+    case OP_MAP: opMap(frame->readByte()); break;
+    case OP_GET_INDEX: opGetIndex(); break;
+    case OP_SET_INDEX: opSetIndex(); break;
+    case OP_LENGTH: opLength(); break;
+    case OP_YIELD:
+      if (!yieldFiber(pop())) return INTERPRET_RUNTIME_ERROR;
+      if (backAtBase(baseFrameCount)) return INTERPRET_OK;
+      break;
+    case OP_RESUME: {
+      Value value = pop();
+      Value target = pop();
+      if (!resumeFiber(target, value)) return INTERPRET_RUNTIME_ERROR;
+      break;
+    }
     case OP_RETURN: 
       Value result = pop();
-      if (callFrames_.size() == 1) {
-        pop();
-        return INTERPRET_OK;
-      }
       // for (size_t i = frame->getFunction()->arity + 1; i > 0; i--) pop();
       for (size_t i = stack_.size() - frame->getSlotStartIndex(); i > 0; i--) pop();
       callFrames_.pop_back();
+      if (callFrames_.empty() && currentFiber_ != nullptr) {
+        finishFiber(result);
+        if (backAtBase(baseFrameCount)) return INTERPRET_OK;
+        break;
+      }
+      if (currentFiber_ == nullptr && callFrames_.size() == baseFrameCount) {
+        if (returnValue != nullptr) *returnValue = result;
+        return INTERPRET_OK;
+      }
       push(result);
       break;
     }
@@ -230,8 +349,17 @@ bool VM::handleNativeFunctionCall(AsasNativeFunction* nativeFn, int argCount) {
   for (int i = 0; i < argCount; i++) {
     args.push_back(peek(argCount - 1 - i));
   }
-  pop();
-  push(nativeFn->call(args));
+  Value result = nativeFn->call(args);
+  // the native raised a runtime error, which already unwound everything
+  if (callFrames_.empty()) return false;
+  for (int i = 0; i <= argCount; i++) pop();
+  if (waitRequested_) {
+    // the result arrives later, as the value the fiber is resumed with
+    waitRequested_ = false;
+    waitFiber();
+    return true;
+  }
+  push(result);
   return true;
 }
 
@@ -246,6 +374,9 @@ void VM::debugVM() {
 }
 
 Value VM::runtimeError(const char *format, ...) {
+  // whatever the script printed so far goes out before the error
+  output_->flush();
+
   va_list args;
   va_start(args, format);
   vfprintf(stderr, format, args);
@@ -267,30 +398,426 @@ Value VM::runtimeError(const char *format, ...) {
     else fprintf(stderr, "%s()\n", function->getName().c_str());
   }
 
-  stack_ = std::vector<Value>();
+  resetStack();
   return std::monostate();
 }
 
+// Leaves the VM ready for the next interpret() call: globals survive, the
+// frames and values of the aborted run do not. Open upvalues are closed
+// first so closures that escaped into globals keep their last values.
+// An error inside a fiber kills it and every fiber waiting on it, back to
+// the main context.
+void VM::resetStack() {
+  for (;;) {
+    for (auto &[slot, upvalue] : openUpvalues_) upvalue->close();
+    openUpvalues_.clear();
+    markedFlags_.reset();
+    callFrames_.clear();
+    stack_.clear();
+    if (currentFiber_ == nullptr) break;
+
+    AsasFiber *fiber = currentFiber_;
+    switchContext(fiber);
+    currentFiber_ = fiber->getCaller();
+    fiber->setCaller(nullptr);
+    fiber->setState(AsasFiber::FIBER_DONE);
+  }
+  abandonTasks();
+}
+
+// A run only returns once its tasks are done, so whatever is still queued
+// or waiting when it unwinds belongs to the run that failed. The event
+// loop goes with it, and the callbacks that were the only way to wake the
+// waiting fibers with that; those are dead now, and no longer GC roots.
+void VM::abandonTasks() {
+  readyFibers_.clear();
+  mainResults_.clear();
+  eventLoop_.reset();
+  std::erase_if(fibers_, [](AsasFiber *fiber) {
+    if (fiber->getState() != AsasFiber::FIBER_WAITING) return false;
+    for (auto &[slot, upvalue] : fiber->getOpenUpvalues()) upvalue->close();
+    fiber->getOpenUpvalues().clear();
+    fiber->setState(AsasFiber::FIBER_DONE);
+    return true;
+  });
+}
+
+void VM::switchContext(AsasFiber *fiber) {
+  std::swap(stack_, fiber->getStack());
+  std::swap(markedFlags_, fiber->getMarkedFlags());
+  std::swap(callFrames_, fiber->getCallFrames());
+  std::swap(openUpvalues_, fiber->getOpenUpvalues());
+}
+
+bool VM::resumeFiber(const Value &target, const Value &value) {
+  auto object = std::get_if<AsasObject*>(&target);
+  AsasFiber *fiber = object != nullptr ? dynamic_cast<AsasFiber*>(*object) : nullptr;
+  if (fiber == nullptr) {
+    runtimeError("Can only resume fibers.");
+    return false;
+  }
+  if (fiber->isDone()) {
+    runtimeError("Cannot resume a finished fiber.");
+    return false;
+  }
+  if (fiber->getState() == AsasFiber::FIBER_RUNNING) {
+    runtimeError("Fiber is already running.");
+    return false;
+  }
+  if (fiber->getState() == AsasFiber::FIBER_WAITING) {
+    runtimeError("Fiber is waiting on an async call.");
+    return false;
+  }
+
+  bool isNew = fiber->getState() == AsasFiber::FIBER_NEW;
+  fiber->setState(AsasFiber::FIBER_RUNNING);
+  fiber->setCaller(currentFiber_);
+  currentFiber_ = fiber;
+  switchContext(fiber);
+
+  if (!isNew) {
+    // the value of the yield expression that suspended it
+    push(value);
+    return true;
+  }
+  AsasClosure *closure = fiber->getClosure();
+  int arity = closure->getFunction()->arity;
+  push(closure);
+  if (arity == 1) push(value);
+  return handleClosureCall(closure, arity);
+}
+
+bool VM::yieldFiber(const Value &value) {
+  if (currentFiber_ == nullptr) {
+    runtimeError("Can't yield outside a fiber.");
+    return false;
+  }
+  AsasFiber *fiber = currentFiber_;
+  switchContext(fiber);
+  currentFiber_ = fiber->getCaller();
+  fiber->setCaller(nullptr);
+  fiber->setState(AsasFiber::FIBER_SUSPENDED);
+  push(value);
+  return true;
+}
+
+// Like a yield of nil, but the fiber stays put until its completion.
+void VM::waitFiber() {
+  AsasFiber *fiber = currentFiber_;
+  switchContext(fiber);
+  currentFiber_ = fiber->getCaller();
+  fiber->setCaller(nullptr);
+  push(std::monostate{});
+}
+
+void VM::finishFiber(const Value &result) {
+  AsasFiber *fiber = currentFiber_;
+  switchContext(fiber);
+  currentFiber_ = fiber->getCaller();
+  fiber->setCaller(nullptr);
+  fiber->setState(AsasFiber::FIBER_DONE);
+  push(result);
+}
+
+void VM::defineNative(const char *name, AsasNativeFunction::NativeFn function) {
+  globals_[name] = allocateObject<AsasNativeFunction>(std::move(function), name);
+}
+
+static AsasFloat64Array *asFloat64Array(const Value &value) {
+  auto object = std::get_if<AsasObject*>(&value);
+  return object != nullptr ? dynamic_cast<AsasFloat64Array*>(*object) : nullptr;
+}
+
 void VM::defineNativeFunctions() {
-  // globals_["clock"] = new AsasNativeFunction(
-  //   [](const std::vector<Value>& args) -> Value {
-  //     return static_cast<double>(clock()) / CLOCKS_PER_SEC;
-  //   },
-  //   "clock"
-  // );
-  //
-  // globals_["delay"] = new AsasNativeFunction(
-  //   [](const std::vector<Value>& args) -> Value {
-  //     if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
-  //       return std::monostate{};
-  //     }
-  //     double seconds = std::get<double>(args[0]);
-  //     clock_t start_time = clock();
-  //     while (static_cast<double>(clock() - start_time) / CLOCKS_PER_SEC < seconds) {
-  //       // Busy-wait loop
-  //     }
-  //     return std::monostate{};
-  //   },
-  //   "delay"
-  // );
+  // fiber(fn) -- a suspended coroutine that runs fn on its first resume;
+  // fn may take one argument, the value passed to that resume.
+  defineNative("fiber", [this](const std::vector<Value> &args) -> Value {
+    AsasFiber *fiber = newFiber(args.size() == 1 ? args[0] : Value{}, "fiber");
+    return fiber != nullptr ? Value{fiber} : Value{};
+  });
+  // spawn(fn) -- like fiber(fn), but the VM runs it as a task: it starts
+  // once the script waits or finishes and is resumed by the event loop.
+  defineNative("spawn", [this](const std::vector<Value> &args) -> Value {
+    AsasFiber *fiber = newFiber(args.size() == 1 ? args[0] : Value{}, "spawn");
+    if (fiber == nullptr) return std::monostate{};
+    readyFibers_.push_back(ReadyFiber{fiber, std::monostate{}});
+    return fiber;
+  });
+  // done(fiber) -- true once the fiber returned or died on an error
+  defineNative("done", [this](const std::vector<Value> &args) -> Value {
+    auto object = args.size() == 1 ? std::get_if<AsasObject*>(&args[0]) : nullptr;
+    AsasFiber *fiber = object != nullptr ? dynamic_cast<AsasFiber*>(*object) : nullptr;
+    if (fiber == nullptr)
+      return runtimeError("done() expects a fiber.");
+    return fiber->isDone();
+  });
+  // push(array, value) -- appends and returns the new length
+  defineNative("push", [this](const std::vector<Value> &args) -> Value {
+    auto object = args.size() == 2 ? std::get_if<AsasObject*>(&args[0]) : nullptr;
+    AsasArray *array = object != nullptr ? dynamic_cast<AsasArray*>(*object) : nullptr;
+    if (array == nullptr)
+      return runtimeError("push() expects an array and a value.");
+    array->push(args[1]);
+    return static_cast<double>(array->size());
+  });
+  // pop(array) -- removes and returns the last element
+  defineNative("pop", [this](const std::vector<Value> &args) -> Value {
+    auto object = args.size() == 1 ? std::get_if<AsasObject*>(&args[0]) : nullptr;
+    AsasArray *array = object != nullptr ? dynamic_cast<AsasArray*>(*object) : nullptr;
+    if (array == nullptr)
+      return runtimeError("pop() expects an array.");
+    if (array->size() == 0)
+      return runtimeError("Can't pop from an empty array.");
+    return array->pop();
+  });
+  // has(map, key) -- whether the key is present
+  defineNative("has", [this](const std::vector<Value> &args) -> Value {
+    auto object = args.size() == 2 ? std::get_if<AsasObject*>(&args[0]) : nullptr;
+    AsasMap *map = object != nullptr ? dynamic_cast<AsasMap*>(*object) : nullptr;
+    if (map == nullptr)
+      return runtimeError("has() expects a map and a key.");
+    Value key = args[1];
+    if (!mapKey(key)) return std::monostate{};
+    return map->contains(key);
+  });
+  // remove(map, key) -- deletes the entry, true if there was one
+  defineNative("remove", [this](const std::vector<Value> &args) -> Value {
+    auto object = args.size() == 2 ? std::get_if<AsasObject*>(&args[0]) : nullptr;
+    AsasMap *map = object != nullptr ? dynamic_cast<AsasMap*>(*object) : nullptr;
+    if (map == nullptr)
+      return runtimeError("remove() expects a map and a key.");
+    Value key = args[1];
+    if (!mapKey(key)) return std::monostate{};
+    return map->remove(key);
+  });
+  // keys(map) -- a new array with the keys, in table order
+  defineNative("keys", [this](const std::vector<Value> &args) -> Value {
+    auto object = args.size() == 1 ? std::get_if<AsasObject*>(&args[0]) : nullptr;
+    AsasMap *map = object != nullptr ? dynamic_cast<AsasMap*>(*object) : nullptr;
+    if (map == nullptr)
+      return runtimeError("keys() expects a map.");
+    std::vector<Value> keys;
+    keys.reserve(map->size());
+    map->forEach([&keys](const Value &key, const Value &) { keys.push_back(key); });
+    return allocateObject<AsasArray>(std::move(keys));
+  });
+  // gcStats() -- the collector counters as a map, keyed like `asas --gc-stats`
+  defineNative("gcStats", [this](const std::vector<Value> &args) -> Value {
+    if (!args.empty())
+      return runtimeError("gcStats() takes no arguments.");
+    GcStats stats = getGcStats();
+    // both maps stay on the stack while the key strings are allocated
+    auto setField = [this](AsasMap *map, const char *name, Value value) {
+      push(allocateString(name, static_cast<int>(strlen(name))));
+      map->set(stack_.back(), value);
+      pop();
+    };
+    AsasMap *result = allocateObject<AsasMap>();
+    push(result);
+    setField(result, "collections", static_cast<double>(stats.collections));
+    setField(result, "objects_allocated", static_cast<double>(stats.objectsAllocated));
+    setField(result, "objects_freed", static_cast<double>(stats.objectsFreed));
+    setField(result, "bytes_allocated", static_cast<double>(stats.bytesAllocated));
+    setField(result, "bytes_freed", static_cast<double>(stats.bytesFreed));
+    setField(result, "live_objects", static_cast<double>(stats.liveObjects));
+    setField(result, "live_bytes", static_cast<double>(stats.liveBytes));
+    setField(result, "next_threshold", static_cast<double>(stats.nextThreshold));
+    setField(result, "mark_ns", static_cast<double>(stats.markNanos));
+    setField(result, "sweep_ns", static_cast<double>(stats.sweepNanos));
+    setField(result, "total_pause_ns", static_cast<double>(stats.totalPauseNanos));
+    setField(result, "max_pause_ns", static_cast<double>(stats.maxPauseNanos));
+    setField(result, "avg_pause_ns", stats.averagePauseNanos());
+
+    AsasMap *byType = allocateObject<AsasMap>();
+    push(byType);
+    for (size_t kind = 0; kind < OBJECT_KIND_COUNT; kind++) {
+      if (stats.liveObjectsByKind[kind] == 0) continue;
+      setField(byType, objectKindName(static_cast<ObjectKind>(kind)), static_cast<double>(stats.liveBytesByKind[kind]));
+    }
+    setField(result, "live_by_type", byType);
+    pop();
+    pop();
+    return result;
+  });
+  // float64Array(length) -- zero filled; float64Array(array) -- a copy of
+  // an array of numbers
+  defineNative("float64Array", [this](const std::vector<Value> &args) -> Value {
+    if (args.size() == 1 && std::holds_alternative<double>(args[0])) {
+      double length = std::get<double>(args[0]);
+      if (!(length >= 0 && length <= static_cast<double>(UINT32_MAX)) || length != static_cast<size_t>(length))
+        return runtimeError("float64Array() length must be a whole number.");
+      return allocateObject<AsasFloat64Array>(static_cast<size_t>(length));
+    }
+    auto object = args.size() == 1 ? std::get_if<AsasObject*>(&args[0]) : nullptr;
+    AsasArray *array = object != nullptr ? dynamic_cast<AsasArray*>(*object) : nullptr;
+    if (array == nullptr)
+      return runtimeError("float64Array() expects a length or an array.");
+    std::vector<double> numbers;
+    numbers.reserve(array->size());
+    for (const Value &element : array->getElements()) {
+      if (!std::holds_alternative<double>(element))
+        return runtimeError("float64Array() elements must be numbers.");
+      numbers.push_back(std::get<double>(element));
+    }
+    return allocateObject<AsasFloat64Array>(std::move(numbers));
+  });
+  // Bulk kernels over Float64Arrays, vectorized for the running CPU, under
+  // an f64 prefix so they leave names like sum and add to scripts.
+  // f64Scale, f64Add and f64PrefixSum work in place and return their first
+  // argument.
+  defineNative("f64Sum", [this](const std::vector<Value> &args) -> Value {
+    AsasFloat64Array *numbers = args.size() == 1 ? asFloat64Array(args[0]) : nullptr;
+    if (numbers == nullptr)
+      return runtimeError("f64Sum() expects a Float64Array.");
+    return float64Kernels().sum(numbers->data(), numbers->size());
+  });
+  defineNative("f64Dot", [this](const std::vector<Value> &args) -> Value {
+    AsasFloat64Array *left = args.size() == 2 ? asFloat64Array(args[0]) : nullptr;
+    AsasFloat64Array *right = args.size() == 2 ? asFloat64Array(args[1]) : nullptr;
+    if (left == nullptr || right == nullptr)
+      return runtimeError("f64Dot() expects two Float64Arrays.");
+    if (left->size() != right->size())
+      return runtimeError("f64Dot() arrays must have the same length.");
+    return float64Kernels().dot(left->data(), right->data(), left->size());
+  });
+  defineNative("f64Scale", [this](const std::vector<Value> &args) -> Value {
+    AsasFloat64Array *numbers = args.size() == 2 ? asFloat64Array(args[0]) : nullptr;
+    if (numbers == nullptr || !std::holds_alternative<double>(args[1]))
+      return runtimeError("f64Scale() expects a Float64Array and a number.");
+    float64Kernels().scale(numbers->data(), numbers->size(), std::get<double>(args[1]));
+    return args[0];
+  });
+  defineNative("f64Add", [this](const std::vector<Value> &args) -> Value {
+    AsasFloat64Array *left = args.size() == 2 ? asFloat64Array(args[0]) : nullptr;
+    AsasFloat64Array *right = args.size() == 2 ? asFloat64Array(args[1]) : nullptr;
+    if (left == nullptr || right == nullptr)
+      return runtimeError("f64Add() expects two Float64Arrays.");
+    if (left->size() != right->size())
+      return runtimeError("f64Add() arrays must have the same length.");
+    float64Kernels().add(left->data(), right->data(), left->size());
+    return args[0];
+  });
+  defineNative("f64Min", [this](const std::vector<Value> &args) -> Value {
+    AsasFloat64Array *numbers = args.size() == 1 ? asFloat64Array(args[0]) : nullptr;
+    if (numbers == nullptr || numbers->size() == 0)
+      return runtimeError("f64Min() expects a non-empty Float64Array.");
+    return float64Kernels().min(numbers->data(), numbers->size());
+  });
+  defineNative("f64Max", [this](const std::vector<Value> &args) -> Value {
+    AsasFloat64Array *numbers = args.size() == 1 ? asFloat64Array(args[0]) : nullptr;
+    if (numbers == nullptr || numbers->size() == 0)
+      return runtimeError("f64Max() expects a non-empty Float64Array.");
+    return float64Kernels().max(numbers->data(), numbers->size());
+  });
+  defineNative("f64PrefixSum", [this](const std::vector<Value> &args) -> Value {
+    AsasFloat64Array *numbers = args.size() == 1 ? asFloat64Array(args[0]) : nullptr;
+    if (numbers == nullptr)
+      return runtimeError("f64PrefixSum() expects a Float64Array.");
+    float64Kernels().prefixSum(numbers->data(), numbers->size());
+    return args[0];
+  });
+  // delay(seconds) -- waits without blocking the other tasks
+  defineNative("delay", makeAsyncNative([this](const std::vector<Value> &args, Completion complete) {
+    if (args.size() != 1 || !std::holds_alternative<double>(args[0]))
+      return void(runtimeError("delay() expects a number of seconds."));
+    getEventLoop().addTimer(std::get<double>(args[0]), [complete]() { complete(std::monostate{}); });
+  }));
+
+}
+
+AsasFiber *VM::newFiber(const Value &function, const char *native) {
+  auto object = std::get_if<AsasObject*>(&function);
+  AsasClosure *closure = object != nullptr ? dynamic_cast<AsasClosure*>(*object) : nullptr;
+  if (closure == nullptr || closure->getFunction()->arity > 1) {
+    runtimeError("%s() expects a function taking at most one argument.", native);
+    return nullptr;
+  }
+  AsasFiber *fiber = allocateObject<AsasFiber>(closure);
+  fibers_.push_back(fiber);
+  return fiber;
+}
+
+void VM::defineAsyncNative(const char *name, AsyncNativeFn function) {
+  globals_[name] = allocateObject<AsasNativeFunction>(makeAsyncNative(std::move(function)), name);
+}
+
+EventLoop &VM::getEventLoop() {
+  if (eventLoop_ == nullptr) eventLoop_ = std::make_unique<EventLoop>();
+  return *eventLoop_;
+}
+
+AsasNativeFunction::NativeFn VM::makeAsyncNative(AsyncNativeFn function) {
+  return [this, function = std::move(function)](const std::vector<Value> &args) -> Value {
+    return callAsync(function, args);
+  };
+}
+
+Value VM::callAsync(const AsyncNativeFn &function, const std::vector<Value> &args) {
+  if (currentFiber_ != nullptr) {
+    AsasFiber *fiber = currentFiber_;
+    fiber->setState(AsasFiber::FIBER_WAITING);
+    function(args, [this, fiber](const Value &result) {
+      if (fiber->getState() == AsasFiber::FIBER_WAITING)
+        readyFibers_.push_back(ReadyFiber{fiber, result});
+    });
+    // handleNativeFunctionCall suspends the fiber once the call is unwound,
+    // unless the native failed and already killed it
+    if (fiber->getState() == AsasFiber::FIBER_WAITING) waitRequested_ = true;
+    return std::monostate{};
+  }
+
+  // The main script has nothing to switch to, so it runs the tasks and the
+  // loop in place until its own completion shows up.
+  uint64_t waitId = nextWaitId_++;
+  auto completed = std::make_shared<bool>(false);
+  mainResults_[waitId] = std::monostate{};
+  function(args, [this, completed, waitId](const Value &result) {
+    auto waiting = mainResults_.find(waitId);
+    if (*completed || waiting == mainResults_.end()) return;
+    *completed = true;
+    waiting->second = result;
+  });
+
+  // the native failed, or a task did while we were waiting
+  if (callFrames_.empty() || runEventLoop([&completed]() { return *completed; }) != INTERPRET_OK) {
+    mainResults_.erase(waitId);
+    return std::monostate{};
+  }
+  Value result = mainResults_[waitId];
+  mainResults_.erase(waitId);
+  if (!*completed) return runtimeError("Async call can never complete: nothing left to wait on.");
+  return result;
+}
+
+InterpretResult VM::runEventLoop(const std::function<bool()> &until) {
+  while (until == nullptr || !until()) {
+    if (!readyFibers_.empty()) {
+      ReadyFiber ready = readyFibers_.front();
+      readyFibers_.pop_front();
+      InterpretResult result = runTask(ready.fiber, ready.value);
+      if (result != INTERPRET_OK) return result;
+      continue;
+    }
+    if (eventLoop_ == nullptr || !eventLoop_->hasPending()) break;
+    eventLoop_->runOnce();
+  }
+  return INTERPRET_OK;
+}
+
+InterpretResult VM::runTask(AsasFiber *fiber, const Value &value) {
+  // killed by an error, or already resumed by hand
+  if (fiber->isDone() || fiber->getState() == AsasFiber::FIBER_RUNNING) return INTERPRET_OK;
+  if (fiber->getState() == AsasFiber::FIBER_WAITING) fiber->setState(AsasFiber::FIBER_SUSPENDED);
+
+  size_t baseFrameCount = callFrames_.size();
+  if (!resumeFiber(fiber, value)) return INTERPRET_RUNTIME_ERROR;
+  InterpretResult result = run(baseFrameCount);
+  if (result != INTERPRET_OK) return result;
+
+  // what the task yielded or returned, nobody is waiting for it
+  pop();
+  // a plain yield just lets the other tasks run
+  if (fiber->getState() == AsasFiber::FIBER_SUSPENDED)
+    readyFibers_.push_back(ReadyFiber{fiber, std::monostate{}});
+  return INTERPRET_OK;
 }
@@ -1,5 +1,16 @@
 #include "vm.h"
 
+// For the string paths, which run on every concatenation: the kind in the
+// object header instead of a dynamic_cast. nullptr when it is not one.
+static AsasString *asString(AsasObject *object) {
+  return object != nullptr && object->getKind() == ObjectKind::STRING
+             ? static_cast<AsasString*>(object) : nullptr;
+}
+static AsasRope *asRope(AsasObject *object) {
+  return object != nullptr && object->getKind() == ObjectKind::ROPE
+             ? static_cast<AsasRope*>(object) : nullptr;
+}
+
 void VM::opEqual() {
   Value b = pop();
   Value a = pop();
@@ -14,11 +25,7 @@ void VM::opEqual() {
         if constexpr (std::is_same_v<X, bool> && std::is_same_v<Y, bool>)
           return x == y;
         if constexpr (std::is_same_v<X, AsasObject*> && std::is_same_v<Y, AsasObject*>) {
-          AsasString* strX = dynamic_cast<AsasString*>(x);
-          AsasString* strY = dynamic_cast<AsasString*>(y);
-          if (strX != nullptr && strY != nullptr)
-            return (strX->getLength() == strY->getLength()) &&
-                   (strcmp(strX->getData(), strY->getData()) == 0);
+          if (isString(x) && isString(y)) return stringsEqual(x, y);
           return x == y; // compare pointers for other object types
         }
         return false;
@@ -63,24 +70,249 @@ void VM::opAdd() {
         if constexpr (std::is_same_v<X, bool> && std::is_same_v<Y, bool>)
           return x || y;
         if constexpr (std::is_same_v<X, AsasObject*> && std::is_same_v<Y, double>) {
-          AsasString* strX = dynamic_cast<AsasString*>(x);
-          if (strX != nullptr) {
-            std::string concatenated = std::string(strX->getData()) + std::to_string(y);
-            return allocateObject<AsasString>(concatenated.c_str());
+          if (isString(x)) {
+            char number[NUMBER_BUFFER_SIZE];
+            int length = formatNumber(number, y);
+            AsasString* strX = asString(x);
+            if (strX != nullptr && strX->getLength() + length < ROPE_MIN_LENGTH)
+              return concatenate(strX, number, length);
+
+            push(x);
+            AsasString* numberString = allocateString(number, length);
+            AsasObject* result = concatenateStrings(x, numberString);
+            pop();
+            return result;
           }
         }
         if constexpr (std::is_same_v<X, AsasObject*> && std::is_same_v<Y, AsasObject*>) {
-          AsasString* strX = dynamic_cast<AsasString*>(x);
-          AsasString* strY = dynamic_cast<AsasString*>(y);
-          if (strX != nullptr && strY != nullptr) {
-            std::string concatenated = std::string(strX->getData()) + std::string(strY->getData());
-            return allocateObject<AsasString>(concatenated.c_str());
-          }
+          if (isString(x) && isString(y)) return concatenateStrings(x, y);
         }
         return runtimeError("Operands must be two numbers or two booleans.");
       }, a, b));
 }
 
+// The elements stay on the stack, and so stay rooted, until the array
+// holding them exists.
+void VM::opArray(int count) {
+  std::vector<Value> elements(stack_.end() - count, stack_.end());
+  AsasArray* array = allocateObject<AsasArray>(std::move(elements));
+  for (int i = 0; i < count; i++) pop();
+  push(array);
+}
+
+// Entries stay on the stack while the map is built; rope keys are
+// flattened in place there, so they stay rooted too.
+void VM::opMap(int count) {
+  AsasMap* map = allocateObject<AsasMap>();
+  push(map);
+  size_t first = stack_.size() - 1 - 2 * count;
+  for (int i = 0; i < count; i++) {
+    if (!mapKey(stack_[first + 2 * i])) return;
+    map->set(stack_[first + 2 * i], stack_[first + 2 * i + 1]);
+  }
+  pop();
+  for (int i = 0; i < 2 * count; i++) pop();
+  push(map);
+}
+
+// Brings a key to the form the map stores: ropes become their flat string.
+// The key must be rooted by the caller, flatten() allocates.
+bool VM::mapKey(Value &key) {
+  if (auto number = std::get_if<double>(&key); number != nullptr && *number != *number) {
+    runtimeError("Map key can't be NaN.");
+    return false;
+  }
+  if (auto object = std::get_if<AsasObject*>(&key))
+    if (auto rope = asRope(*object)) key = flatten(rope);
+  return true;
+}
+
+void VM::opGetIndex() {
+  Value target = peek(1);
+  auto object = std::get_if<AsasObject*>(&target);
+  if (object != nullptr) {
+    if (auto map = dynamic_cast<AsasMap*>(*object)) {
+      Value key = peek();
+      if (!mapKey(key)) return;
+      Value value;
+      if (!map->get(key, value)) value = std::monostate{};
+      pop();
+      pop();
+      return push(value);
+    }
+    if (auto numbers = dynamic_cast<AsasFloat64Array*>(*object)) {
+      Value index = pop();
+      pop();
+      size_t slot;
+      if (!std::holds_alternative<double>(index)) return void(runtimeError("Array index must be a number."));
+      if (!numbers->isValidIndex(std::get<double>(index), slot))
+        return void(runtimeError("Array index %g out of bounds for length %zu.", std::get<double>(index), numbers->size()));
+      return push(numbers->at(slot));
+    }
+  }
+
+  Value index = pop();
+  pop();
+  AsasArray* array = object != nullptr ? dynamic_cast<AsasArray*>(*object) : nullptr;
+  if (array == nullptr) return void(runtimeError("Can only index arrays and maps."));
+  if (!std::holds_alternative<double>(index)) return void(runtimeError("Array index must be a number."));
+
+  size_t slot;
+  if (!array->isValidIndex(std::get<double>(index), slot))
+    return void(runtimeError("Array index %g out of bounds for length %zu.", std::get<double>(index), array->size()));
+  push(array->at(slot));
+}
+
+void VM::opSetIndex() {
+  Value target = peek(2);
+  auto object = std::get_if<AsasObject*>(&target);
+  if (object != nullptr) {
+    if (auto map = dynamic_cast<AsasMap*>(*object)) {
+      Value key = peek(1);
+      if (!mapKey(key)) return;
+      Value value = pop();
+      map->set(key, value);
+      pop();
+      pop();
+      return push(value);
+    }
+    if (auto numbers = dynamic_cast<AsasFloat64Array*>(*object)) {
+      Value value = pop();
+      Value index = pop();
+      pop();
+      size_t slot;
+      if (!std::holds_alternative<double>(index)) return void(runtimeError("Array index must be a number."));
+      if (!numbers->isValidIndex(std::get<double>(index), slot))
+        return void(runtimeError("Array index %g out of bounds for length %zu.", std::get<double>(index), numbers->size()));
+      if (!std::holds_alternative<double>(value)) return void(runtimeError("Float64Array elements must be numbers."));
+      numbers->set(slot, std::get<double>(value));
+      return push(value);
+    }
+  }
+
+  Value value = pop();
+  Value index = pop();
+  pop();
+  AsasArray* array = object != nullptr ? dynamic_cast<AsasArray*>(*object) : nullptr;
+  if (array == nullptr) return void(runtimeError("Can only index arrays and maps."));
+  if (!std::holds_alternative<double>(index)) return void(runtimeError("Array index must be a number."));
+
+  size_t slot;
+  if (!array->isValidIndex(std::get<double>(index), slot))
+    return void(runtimeError("Array index %g out of bounds for length %zu.", std::get<double>(index), array->size()));
+  array->set(slot, value);
+  push(value);
+}
+
+void VM::opLength() {
+  Value target = pop();
+  auto object = std::get_if<AsasObject*>(&target);
+  if (object != nullptr) {
+    if (auto array = dynamic_cast<AsasArray*>(*object))
+      return push(static_cast<double>(array->size()));
+    if (auto map = dynamic_cast<AsasMap*>(*object))
+      return push(static_cast<double>(map->size()));
+    if (auto numbers = dynamic_cast<AsasFloat64Array*>(*object))
+      return push(static_cast<double>(numbers->size()));
+    if (isString(*object))
+      return push(static_cast<double>(AsasRope::lengthOf(*object)));
+  }
+  runtimeError("Only arrays, maps and strings have a length.");
+}
+
+// The operands were already popped, so `left` is pushed back while the
+// result is allocated; the caller keeps `right` alive the same way.
+AsasString* VM::concatenate(AsasString *left, const char *right, int rightLength) {
+  push(left);
+  AsasString* result = allocateString(nullptr, left->getLength() + rightLength);
+  pop();
+
+  char* chars = result->getMutableData();
+  memcpy(chars, left->getData(), left->getLength());
+  memcpy(chars + left->getLength(), right, rightLength);
+  return result;
+}
+
+// Both operands are AsasString or AsasRope. Short results are copied
+// eagerly; longer ones become a rope node so `s = s + x` loops stay linear.
+AsasObject* VM::concatenateStrings(AsasObject *left, AsasObject *right) {
+  if (auto rope = asRope(left); rope != nullptr && rope->getFlat() != nullptr)
+    left = rope->getFlat();
+  if (auto rope = asRope(right); rope != nullptr && rope->getFlat() != nullptr)
+    right = rope->getFlat();
+
+  AsasString* leftString = asString(left);
+  AsasString* rightString = asString(right);
+  int length = AsasRope::lengthOf(left) + AsasRope::lengthOf(right);
+  if (leftString != nullptr && rightString != nullptr && length < ROPE_MIN_LENGTH) {
+    push(rightString);
+    AsasString* result = concatenate(leftString, rightString->getData(), rightString->getLength());
+    pop();
+    return result;
+  }
+
+  push(left);
+  push(right);
+  AsasObject* result;
+  AsasRope* leftRope = asRope(left);
+  AsasRope* rightRope = asRope(right);
+  AsasString* tail = leftRope != nullptr ? asString(leftRope->getRight()) : nullptr;
+  AsasString* head = rightRope != nullptr ? asString(rightRope->getLeft()) : nullptr;
+  if (tail != nullptr && rightString != nullptr &&
+      tail->getLength() + rightString->getLength() < ROPE_MIN_LENGTH) {
+    // merge short appends into the rightmost leaf instead of growing the rope
+    AsasString* merged = concatenate(tail, rightString->getData(), rightString->getLength());
+    push(merged);
+    result = allocateObject<AsasRope>(leftRope->getLeft(), merged);
+    pop();
+  } else if (head != nullptr && leftString != nullptr &&
+             leftString->getLength() + head->getLength() < ROPE_MIN_LENGTH) {
+    // and short prepends into the leftmost leaf
+    AsasString* merged = concatenate(leftString, head->getData(), head->getLength());
+    push(merged);
+    result = allocateObject<AsasRope>(merged, rightRope->getRight());
+    pop();
+  } else {
+    // either side may be the deep one: `s = s + x` and `s = x + s` alike
+    if (leftRope != nullptr && leftRope->getDepth() >= ROPE_MAX_DEPTH)
+      left = flatten(leftRope);
+    if (rightRope != nullptr && rightRope->getDepth() >= ROPE_MAX_DEPTH)
+      right = flatten(rightRope);
+    result = allocateObject<AsasRope>(left, right);
+  }
+  pop();
+  pop();
+  return result;
+}
+
+AsasString* VM::flatten(AsasRope *rope) {
+  if (rope->getFlat() != nullptr) return rope->getFlat();
+
+  push(rope);
+  AsasString* flat = allocateString(nullptr, rope->getLength());
+  pop();
+
+  rope->copyTo(flat->getMutableData());
+  rope->setFlat(flat);
+  return flat;
+}
+
+bool VM::stringsEqual(AsasObject *left, AsasObject *right) {
+  if (left == right) return true;
+  if (AsasRope::lengthOf(left) != AsasRope::lengthOf(right)) return false;
+
+  push(left);
+  push(right);
+  AsasRope* leftRope = asRope(left);
+  AsasRope* rightRope = asRope(right);
+  AsasString* leftString = leftRope != nullptr ? flatten(leftRope) : static_cast<AsasString*>(left);
+  AsasString* rightString = rightRope != nullptr ? flatten(rightRope) : static_cast<AsasString*>(right);
+  pop();
+  pop();
+
+  return memcmp(leftString->getData(), rightString->getData(), leftString->getLength()) == 0;
+}
+
 void VM::opSubtract() {
   Value b = pop();
   Value a = pop();
@@ -0,0 +1,61 @@
+#include "asas_map.h"
+#include <gtest/gtest.h>
+
+TEST(AsasMapTest, InsertLookupAndGrow) {
+  AsasMap map;
+  for (int i = 0; i < 1000; i++)
+    EXPECT_TRUE(map.set(static_cast<double>(i), static_cast<double>(i * 2)));
+  EXPECT_FALSE(map.set(7.0, 0.0));
+
+  EXPECT_EQ(map.size(), 1000u);
+  EXPECT_LE(map.size() * 8, map.capacity() * 7);
+  Value value;
+  ASSERT_TRUE(map.get(999.0, value));
+  EXPECT_EQ(std::get<double>(value), 1998.0);
+  ASSERT_TRUE(map.get(7.0, value));
+  EXPECT_EQ(std::get<double>(value), 0.0);
+  EXPECT_FALSE(map.get(1000.0, value));
+}
+
+TEST(AsasMapTest, TombstonesAreReused) {
+  AsasMap map;
+  for (int i = 0; i < 100; i++) map.set(static_cast<double>(i), true);
+  size_t capacity = map.capacity();
+
+  // churn through many more keys than the table holds; without tombstone
+  // reuse or in-place rehashing the table would keep growing
+  for (int round = 0; round < 50; round++) {
+    for (int i = 0; i < 100; i++) EXPECT_TRUE(map.remove(static_cast<double>(round * 100 + i)));
+    for (int i = 0; i < 100; i++) map.set(static_cast<double>((round + 1) * 100 + i), true);
+  }
+
+  EXPECT_EQ(map.size(), 100u);
+  EXPECT_LE(map.capacity(), capacity * 2);
+  EXPECT_FALSE(map.contains(0.0));
+  EXPECT_TRUE(map.contains(5099.0));
+  EXPECT_FALSE(map.remove(0.0));
+}
+
+TEST(AsasMapTest, KeysOfDifferentTypes) {
+  AsasMap map;
+  AsasObject *a = AsasString::create("key");
+  AsasObject *b = AsasString::create("key");
+  map.set(a, 1.0);
+  map.set(true, 2.0);
+  map.set(std::monostate{}, 3.0);
+  map.set(1.0, 4.0);
+
+  Value value;
+  ASSERT_TRUE(map.get(b, value)); // same content, other object
+  EXPECT_EQ(std::get<double>(value), 1.0);
+  ASSERT_TRUE(map.get(std::monostate{}, value));
+  EXPECT_EQ(std::get<double>(value), 3.0);
+  ASSERT_TRUE(map.get(1.0, value));
+  EXPECT_EQ(std::get<double>(value), 4.0);
+  ASSERT_TRUE(map.get(true, value));
+  EXPECT_EQ(std::get<double>(value), 2.0);
+  EXPECT_FALSE(map.contains(false));
+  EXPECT_EQ(map.size(), 4u);
+  delete a;
+  delete b;
+}
@@ -0,0 +1,162 @@
+#include "compiler.h"
+#include "parallel_marker.h"
+#include "vm.h"
+#include <gtest/gtest.h>
+#include <climits>
+#include <unordered_set>
+
+static void deleteObjectGraph(AsasObject *root) {
+  std::vector<AsasObject*> objects{root};
+  std::unordered_set<AsasObject*> seen{root};
+  for (size_t i = 0; i < objects.size(); i++) {
+    forEachReference(objects[i], [&](AsasObject *ref) {
+      if (ref != nullptr && seen.insert(ref).second) objects.push_back(ref);
+    });
+  }
+  for (AsasObject *object : objects) delete object;
+}
+
+static int stringConstants(const AsasFunction *function, const std::string &text) {
+  int count = 0;
+  for (const Value &constant : function->getChunk()->getConstants()) {
+    auto object = std::get_if<AsasObject*>(&constant);
+    auto string = object != nullptr ? dynamic_cast<AsasString*>(*object) : nullptr;
+    if (string != nullptr && string->getData() == text) count++;
+  }
+  return count;
+}
+
+TEST(CompilerTest, GlobalNamesShareOneConstant) {
+  Isolate isolate;
+  IsolateScope isolateScope(isolate);
+  const char *source = "var total = 1;\ntotal = total + total;\nprint total;\nprint \"total\";\n";
+  AsasString *name = AsasString::create("<script>");
+  Compiler compiler(source, name, FunctionType::SCRIPT);
+  AsasFunction *function = compiler.compile();
+  ASSERT_NE(function, nullptr);
+
+  // the name once, the string literal on its own
+  EXPECT_EQ(stringConstants(function, "total"), 2);
+
+  deleteObjectGraph(function);
+}
+
+// Nested functions, names and strings made before the error are freed with
+// the failed compile.
+TEST(CompilerTest, FailedCompileFreesItsObjects) {
+  Isolate isolate;
+  IsolateScope isolateScope(isolate);
+  const char *source =
+      "func outer(a) {\n"
+      "  func inner(b) { return a + b + \"text\"; }\n"
+      "  return inner;\n"
+      "}\n"
+      "var x = outer(1;\n";
+  AsasString *name = AsasString::create("<script>");
+  int before = AsasObject::getRefCountObjects();
+
+  testing::internal::CaptureStderr();
+  Compiler compiler(source, name, FunctionType::SCRIPT);
+  EXPECT_EQ(compiler.compile(), nullptr);
+  testing::internal::GetCapturedStderr();
+
+  EXPECT_EQ(AsasObject::getRefCountObjects(), before);
+  delete name;
+}
+
+// Top-level functions with closures, loops and calls between them, and
+// braces the pre-scan must not be fooled by: in strings, comments, map
+// literals and a block whose function isn't top-level. Each function takes
+// two of the script's 256 constants, its name and its closure.
+static std::string generatedModule(int functions, int brokenEvery = 0) {
+  std::string source = "var table = {\"{\": 1, \"}\": 2};\n{ func hidden() { return 0; } }\n";
+  for (int i = 0; i < functions; i++) {
+    std::string n = std::to_string(i);
+    source += "// func fake" + n + "() { }\n";
+    source += "func f" + n + "(a, b) {\n"
+              "  var total = a * " + n + ".5;\n"
+              "  func add(x) { total = total + x + b; return total; }\n"
+              "  var i = 0;\n"
+              "  while (i < 3) { add(i); i = i + 1; }\n"
+              "  print \"f" + n + " {\" + \"}\";\n";
+    if (i > 0) source += "  return f" + std::to_string(i - 1) + "(total, add(1));\n";
+    if (brokenEvery != 0 && i % brokenEvery == brokenEvery - 1) source += "  var = ;\n";
+    source += "}\n";
+  }
+  source += "print f" + std::to_string(functions - 1) + "(1, 2);\n";
+  return source;
+}
+
+static void expectSameFunction(const AsasFunction *a, const AsasFunction *b) {
+  ASSERT_EQ(a->getName(), b->getName());
+  EXPECT_EQ(a->arity, b->arity);
+  EXPECT_EQ(a->getUpvalueCount(), b->getUpvalueCount());
+  const Chunk *chunkA = a->getChunk();
+  const Chunk *chunkB = b->getChunk();
+  ASSERT_EQ(chunkA->getCode(), chunkB->getCode()) << a->getName();
+  for (size_t i = 0; i < chunkA->getCode().size(); i++)
+    ASSERT_EQ(chunkA->getLineAt(i), chunkB->getLineAt(i)) << a->getName() << " at " << i;
+  ASSERT_EQ(chunkA->getConstants().size(), chunkB->getConstants().size());
+  for (size_t i = 0; i < chunkA->getConstants().size(); i++) {
+    const Value &x = chunkA->getConstantAt(i);
+    const Value &y = chunkB->getConstantAt(i);
+    ASSERT_EQ(x.index(), y.index());
+    if (auto number = std::get_if<double>(&x)) {
+      EXPECT_EQ(*number, std::get<double>(y));
+    } else if (auto object = std::get_if<AsasObject*>(&x)) {
+      AsasObject *other = std::get<AsasObject*>(y);
+      if (auto function = dynamic_cast<AsasFunction*>(*object)) {
+        ASSERT_NE(dynamic_cast<AsasFunction*>(other), nullptr);
+        expectSameFunction(function, static_cast<AsasFunction*>(other));
+      } else {
+        auto string = dynamic_cast<AsasString*>(*object);
+        ASSERT_NE(string, nullptr);
+        EXPECT_STREQ(string->getData(), static_cast<AsasString*>(other)->getData());
+      }
+    }
+  }
+}
+
+TEST(CompilerTest, ParallelCompileMatchesSequential) {
+  Isolate isolate;
+  IsolateScope isolateScope(isolate);
+  std::string source = generatedModule(120);
+
+  Compiler sequential(source.data(), source.size(), AsasString::create("<script>"));
+  sequential.setParallelCompile(SIZE_MAX);
+  AsasFunction *expected = sequential.compile();
+  ASSERT_NE(expected, nullptr);
+
+  Compiler parallel(source.data(), source.size(), AsasString::create("<script>"));
+  parallel.setParallelCompile(0, 4);
+  AsasFunction *function = parallel.compile();
+  ASSERT_NE(function, nullptr);
+  expectSameFunction(function, expected);
+
+  deleteObjectGraph(expected);
+  deleteObjectGraph(function);
+  EXPECT_EQ(AsasObject::getRefCountObjects(), 0);
+}
+
+// Functions that fail on the workers are compiled again in place: the
+// errors come out as the sequential compile reports them, nothing leaks.
+TEST(CompilerTest, ParallelCompileReportsErrorsInOrder) {
+  Isolate isolate;
+  IsolateScope isolateScope(isolate);
+  std::string source = generatedModule(40, 7) + "print (;\n";
+  std::string reports[2];
+  for (int parallel = 0; parallel < 2; parallel++) {
+    AsasString *name = AsasString::create("<script>");
+    Compiler compiler(source.data(), source.size(), name);
+    compiler.setParallelCompile(parallel ? 0 : SIZE_MAX, 4);
+    testing::internal::CaptureStderr();
+    testing::internal::CaptureStdout();
+    EXPECT_EQ(compiler.compile(), nullptr);
+    reports[parallel] = testing::internal::GetCapturedStdout();
+    reports[parallel] += testing::internal::GetCapturedStderr();
+    delete name;
+  }
+  EXPECT_NE(reports[0].find("[line 64] Error: Expect variable name."), std::string::npos) << reports[0];
+  EXPECT_EQ(reports[1], reports[0]);
+  EXPECT_EQ(AsasObject::getRefCountObjects(), 0);
+}
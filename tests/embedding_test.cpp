@@ -0,0 +1,122 @@
+#include "vm.h"
+#include "object.h"
+#include <gtest/gtest.h>
+
+TEST(EmbeddingTest, CallGlobalFunctionWithArguments) {
+  VM vm;
+  vm.setOutputSink(std::make_unique<MemoryOutputSink>());
+  ASSERT_EQ(vm.interpret("func add(a, b) { return a + b; }"), INTERPRET_OK);
+
+  Value result;
+  ASSERT_EQ(vm.callFunction("add", {3.0, 4.5}, &result), INTERPRET_OK);
+  ASSERT_TRUE(std::holds_alternative<double>(result));
+  EXPECT_EQ(std::get<double>(result), 7.5);
+  EXPECT_EQ(vm.stackSize(), 0);
+
+  // the VM is reusable after a call
+  ASSERT_EQ(vm.callFunction("add", {1.0, 1.0}, &result), INTERPRET_OK);
+  EXPECT_EQ(std::get<double>(result), 2.0);
+}
+
+TEST(EmbeddingTest, StringArgumentsAndResults) {
+  VM vm;
+  vm.setOutputSink(std::make_unique<MemoryOutputSink>());
+  ASSERT_EQ(vm.interpret("func greet(name) { return \"hello \" + name; }"), INTERPRET_OK);
+
+  Value result;
+  ASSERT_EQ(vm.callFunction("greet", {vm.makeString("asas")}, &result), INTERPRET_OK);
+  auto *string = dynamic_cast<AsasString *>(std::get<AsasObject *>(result));
+  ASSERT_NE(string, nullptr);
+  EXPECT_EQ(std::string(string->getData(), string->getLength()), "hello asas");
+}
+
+TEST(EmbeddingTest, CompiledScriptsAreCached) {
+  VM vm;
+  auto sink = std::make_unique<MemoryOutputSink>();
+  MemoryOutputSink *memory = sink.get();
+  vm.setOutputSink(std::move(sink));
+
+  const char *source = "print counter; counter = counter + 1;";
+  vm.setGlobal("counter", 1.0);
+  AsasFunction *script = vm.compile(source);
+  ASSERT_NE(script, nullptr);
+  EXPECT_EQ(vm.compile(source), script);
+  EXPECT_EQ(vm.getScriptCache().getHits(), 1u);
+
+  ASSERT_EQ(vm.execute(script), INTERPRET_OK);
+  ASSERT_EQ(vm.interpret(source), INTERPRET_OK);
+  EXPECT_EQ(memory->getContents(), "-> 1.00\n-> 2.00\n");
+
+  Value counter;
+  ASSERT_TRUE(vm.getGlobal("counter", counter));
+  EXPECT_EQ(std::get<double>(counter), 3.0);
+}
+
+TEST(EmbeddingTest, CacheEvictsLeastRecentlyUsed) {
+  VM vm;
+  vm.getScriptCache().setCapacity(2);
+  AsasFunction *first = vm.compile("var a = 1;");
+  vm.compile("var b = 2;");
+  EXPECT_EQ(vm.compile("var a = 1;"), first);
+  vm.compile("var c = 3;");
+
+  EXPECT_EQ(vm.getScriptCache().size(), 2u);
+  EXPECT_EQ(vm.compile("var a = 1;"), first);
+  size_t misses = vm.getScriptCache().getMisses();
+  vm.compile("var b = 2;");
+  EXPECT_EQ(vm.getScriptCache().getMisses(), misses + 1);
+}
+
+TEST(EmbeddingTest, ResetClearsGlobals) {
+  VM vm;
+  vm.setOutputSink(std::make_unique<MemoryOutputSink>());
+  ASSERT_EQ(vm.interpret("var x = 10;"), INTERPRET_OK);
+  Value value;
+  EXPECT_TRUE(vm.getGlobal("x", value));
+
+  vm.reset();
+  EXPECT_FALSE(vm.getGlobal("x", value));
+  EXPECT_EQ(vm.getScriptCache().size(), 1u);
+}
+
+TEST(EmbeddingTest, NativesAreDefinedOnceAndAfterReset) {
+  VM vm;
+  auto sink = std::make_unique<MemoryOutputSink>();
+  MemoryOutputSink *memory = sink.get();
+  vm.setOutputSink(std::move(sink));
+  Value native;
+  ASSERT_TRUE(vm.getGlobal("keys", native));
+
+  ASSERT_EQ(vm.interpret("func keys(m) { return 42; }"), INTERPRET_OK);
+  Value result;
+  ASSERT_EQ(vm.callFunction("keys", {Value{}}, &result), INTERPRET_OK);
+  EXPECT_EQ(std::get<double>(result), 42.0);
+  // a later run does not put the native back over the script's function
+  ASSERT_EQ(vm.interpret("var x = 1;"), INTERPRET_OK);
+  ASSERT_EQ(vm.callFunction("keys", {Value{}}, &result), INTERPRET_OK);
+  EXPECT_EQ(std::get<double>(result), 42.0);
+
+  vm.reset();
+  Value restored;
+  ASSERT_TRUE(vm.getGlobal("keys", restored));
+  EXPECT_NE(std::get<AsasObject*>(restored), std::get<AsasObject*>(native));
+  ASSERT_EQ(vm.interpret("print keys({\"a\": 1})[0];"), INTERPRET_OK);
+  EXPECT_EQ(memory->getContents(), "-> a\n");
+}
+
+TEST(EmbeddingTest, RuntimeErrorLeavesVmUsable) {
+  VM vm;
+  vm.setOutputSink(std::make_unique<MemoryOutputSink>());
+  ASSERT_EQ(vm.interpret("func boom() { return missing; } func one() { return 1; }"), INTERPRET_OK);
+
+  testing::internal::CaptureStderr();
+  EXPECT_EQ(vm.callFunction("boom", {}), INTERPRET_RUNTIME_ERROR);
+  EXPECT_EQ(vm.callFunction("nothing", {}), INTERPRET_RUNTIME_ERROR);
+  EXPECT_EQ(vm.callFunction("one", {2.0}), INTERPRET_RUNTIME_ERROR);
+  testing::internal::GetCapturedStderr();
+  EXPECT_EQ(vm.stackSize(), 0);
+
+  Value result;
+  ASSERT_EQ(vm.callFunction("one", {}, &result), INTERPRET_OK);
+  EXPECT_EQ(std::get<double>(result), 1.0);
+}
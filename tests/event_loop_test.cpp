@@ -0,0 +1,106 @@
+#include "event_loop.h"
+#include "vm.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+
+TEST(EventLoopTest, TimersFireInDeadlineOrder) {
+  EventLoop loop;
+  std::string order;
+  loop.addTimer(0.02, [&order]() { order += "c"; });
+  loop.addTimer(0.0, [&order]() { order += "a"; });
+  loop.addTimer(0.01, [&order]() { order += "b"; });
+  loop.addTimer(0.0, [&order]() { order += "A"; });
+
+  while (loop.hasPending()) loop.runOnce();
+  EXPECT_EQ(order, "aAbc");
+}
+
+TEST(EventLoopTest, WatchesPipeOnce) {
+  EventLoop loop;
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  int calls = 0;
+  ASSERT_TRUE(loop.watchReadable(fds[0], [&calls]() { calls++; }));
+  EXPECT_FALSE(loop.watchReadable(fds[0], []() {}));
+  EXPECT_EQ(loop.runOnce(0), 0u);
+
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  EXPECT_EQ(loop.runOnce(), 1u);
+  EXPECT_EQ(calls, 1);
+  EXPECT_FALSE(loop.hasPending());
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(EventLoopTest, AsyncNativeResumesFiberWhenPipeIsReadable) {
+  VM vm;
+  auto sink = std::make_unique<MemoryOutputSink>();
+  MemoryOutputSink *output = sink.get();
+  vm.setOutputSink(std::move(sink));
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  vm.defineAsyncNative("readPipe", [&vm, &fds](const std::vector<Value> &, VM::Completion complete) {
+    vm.getEventLoop().watchReadable(fds[0], [&vm, &fds, complete]() {
+      char buffer[16];
+      ssize_t length = read(fds[0], buffer, sizeof(buffer));
+      complete(vm.makeString(std::string(buffer, static_cast<size_t>(length))));
+    });
+  });
+  vm.getEventLoop().addTimer(0.01, [&fds]() { (void)!write(fds[1], "ping", 4); });
+
+  const char *source =
+      "func reader() { print \"got \" + readPipe(); }\n"
+      "func other() { print \"other runs meanwhile\"; }\n"
+      "spawn(reader);\n"
+      "spawn(other);\n";
+  EXPECT_EQ(vm.interpret(source), INTERPRET_OK);
+  EXPECT_EQ(output->getContents(), "-> other runs meanwhile\n-> got ping\n");
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// A line that fails takes the tasks it spawned with it: none of them runs
+// during the next line.
+TEST(EventLoopTest, RuntimeErrorDropsSpawnedTasks) {
+  VM vm;
+  auto sink = std::make_unique<MemoryOutputSink>();
+  MemoryOutputSink *output = sink.get();
+  vm.setOutputSink(std::move(sink));
+
+  testing::internal::CaptureStderr();
+  EXPECT_EQ(vm.interpret("func t() { print \"stale task ran\"; }\nspawn(t);\nvar x = nil;\nx();\n"),
+            INTERPRET_RUNTIME_ERROR);
+  testing::internal::GetCapturedStderr();
+  EXPECT_EQ(vm.interpret("print 1;"), INTERPRET_OK);
+  EXPECT_EQ(output->getContents(), "-> 1.00\n");
+}
+
+// The task waiting on its timer when the run fails loses the only callback
+// that could wake it; it must not stay a GC root after reset().
+TEST(EventLoopTest, ResetFreesTasksLeftWaiting) {
+  VM vm;
+  vm.setOutputSink(std::make_unique<MemoryOutputSink>());
+  const char *failing =
+      "func holder() { var big = float64Array(100000); delay(10); print big; }\n"
+      "spawn(holder);\n"
+      "delay(0);\n"
+      "var x = nil;\n"
+      "x();\n";
+  for (int run = 0; run < 3; run++) {
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(vm.interpret(failing), INTERPRET_RUNTIME_ERROR);
+    testing::internal::GetCapturedStderr();
+    vm.reset();
+  }
+
+  ASSERT_EQ(vm.interpret("var s = \"\";\nfor (var i = 0; i < 5000; i = i + 1) s = s + \"a\";\n"),
+            INTERPRET_OK);
+  GcStats stats = vm.getGcStats();
+  EXPECT_GT(stats.collections, 0u);
+  EXPECT_EQ(stats.liveObjectsByKind[static_cast<size_t>(ObjectKind::FLOAT64_ARRAY)], 0u);
+}
@@ -0,0 +1,53 @@
+#include "float64_array.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+// Every kernel table the machine can run must agree with the scalar one,
+// including on the lengths that leave a tail after the vector loop.
+TEST(Float64KernelsTest, VectorKernelsMatchScalar) {
+  const Float64Kernels *scalar = float64KernelsFor(SimdLevel::SCALAR);
+  ASSERT_NE(scalar, nullptr);
+
+  for (SimdLevel level : {SimdLevel::SSE2, SimdLevel::AVX2}) {
+    const Float64Kernels *kernels = float64KernelsFor(level);
+    if (kernels == nullptr) continue;
+    SCOPED_TRACE(kernels->name);
+
+    for (size_t count : {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 100, 1001}) {
+      SCOPED_TRACE(count);
+      std::vector<double> left(count), right(count);
+      for (size_t i = 0; i < count; i++) {
+        left[i] = std::sin(static_cast<double>(i)) * 100;
+        right[i] = static_cast<double>(i % 7) - 3;
+      }
+
+      EXPECT_NEAR(kernels->sum(left.data(), count), scalar->sum(left.data(), count), 1e-9);
+      EXPECT_NEAR(kernels->dot(left.data(), right.data(), count),
+                  scalar->dot(left.data(), right.data(), count), 1e-9);
+      EXPECT_EQ(kernels->min(left.data(), count), scalar->min(left.data(), count));
+      EXPECT_EQ(kernels->max(left.data(), count), scalar->max(left.data(), count));
+
+      std::vector<double> expected = left, actual = left;
+      scalar->scale(expected.data(), count, 1.5);
+      kernels->scale(actual.data(), count, 1.5);
+      EXPECT_EQ(actual, expected);
+
+      scalar->add(expected.data(), right.data(), count);
+      kernels->add(actual.data(), right.data(), count);
+      EXPECT_EQ(actual, expected);
+
+      scalar->prefixSum(expected.data(), count);
+      kernels->prefixSum(actual.data(), count);
+      for (size_t i = 0; i < count; i++) EXPECT_NEAR(actual[i], expected[i], 1e-9);
+    }
+  }
+}
+
+TEST(Float64KernelsTest, SelectsAnAvailableLevel) {
+  const Float64Kernels &kernels = float64Kernels();
+  std::vector<double> values = {3, -1, 4, 1, -5, 9};
+  EXPECT_EQ(kernels.sum(values.data(), values.size()), 11);
+  EXPECT_EQ(kernels.min(values.data(), values.size()), -5);
+  EXPECT_EQ(kernels.max(values.data(), values.size()), 9);
+}
@@ -0,0 +1,127 @@
+#include "asas_fixture.h"
+#include "gc_stats.h"
+#include "vm.h"
+#include <gtest/gtest.h>
+
+static const char *CHURN_SOURCE =
+    "var str = \"\";\n"
+    "for (var i = 0; i < 5000; i = i + 1) {\n"
+    "  str = \"a\" + str;\n"
+    "}\n"
+    "var numbers = [1, 2, 3];\n";
+
+TEST(GcStatsTest, CountsCollectionsAndBytes) {
+  VM vm;
+  GcStats empty = vm.getGcStats();
+  EXPECT_EQ(empty.collections, 0u);
+  // only the natives, defined when the VM is built
+  EXPECT_GT(empty.liveObjects, 0u);
+  EXPECT_EQ(empty.liveObjects,
+            empty.liveObjectsByKind[static_cast<size_t>(ObjectKind::NATIVE_FUNCTION)]);
+  EXPECT_EQ(empty.averagePauseNanos(), 0.0);
+
+  ASSERT_EQ(vm.interpret(CHURN_SOURCE), INTERPRET_OK);
+  GcStats stats = vm.getGcStats();
+
+  EXPECT_GT(stats.collections, 0u);
+  EXPECT_GT(stats.objectsFreed, 0u);
+  EXPECT_GT(stats.bytesFreed, 0u);
+  // everything freed was counted when it was allocated
+  EXPECT_EQ(stats.objectsAllocated - stats.objectsFreed, stats.liveObjects);
+  EXPECT_EQ(stats.bytesAllocated - stats.bytesFreed, stats.liveBytes);
+  EXPECT_GE(stats.nextThreshold, static_cast<uint64_t>(GC_INITIAL_THRESHOLD));
+
+  uint64_t objects = 0, bytes = 0;
+  for (size_t kind = 0; kind < OBJECT_KIND_COUNT; kind++) {
+    objects += stats.liveObjectsByKind[kind];
+    bytes += stats.liveBytesByKind[kind];
+  }
+  EXPECT_EQ(objects, stats.liveObjects);
+  EXPECT_EQ(bytes, stats.liveBytes);
+  EXPECT_GT(stats.liveObjectsByKind[static_cast<size_t>(ObjectKind::ARRAY)], 0u);
+  EXPECT_GT(stats.liveObjectsByKind[static_cast<size_t>(ObjectKind::NATIVE_FUNCTION)], 0u);
+
+  EXPECT_EQ(stats.totalPauseNanos, stats.markNanos + stats.sweepNanos);
+  EXPECT_GE(stats.maxPauseNanos, stats.lastPauseNanos);
+  EXPECT_LE(stats.averagePauseNanos(), static_cast<double>(stats.maxPauseNanos));
+}
+
+// Arrays and maps that grow after they were registered, some swept and one
+// still growing after the last collection.
+TEST(GcStatsTest, GrowingContainersBalanceBytes) {
+  VM vm;
+  const char *source =
+      "var kept = [];\n"
+      "for (var round = 0; round < 20; round = round + 1) {\n"
+      "  var numbers = [];\n"
+      "  for (var i = 0; i < 5000; i = i + 1) push(numbers, i);\n"
+      "  var table = {};\n"
+      "  for (var i = 0; i < 200; i = i + 1) table[i] = i;\n"
+      "  var str = \"\";\n"
+      "  for (var i = 0; i < 500; i = i + 1) str = \"a\" + str;\n"
+      "  kept = numbers;\n"
+      "}\n"
+      "for (var i = 0; i < 5000; i = i + 1) push(kept, i);\n";
+
+  ASSERT_EQ(vm.interpret(source), INTERPRET_OK);
+  GcStats stats = vm.getGcStats();
+
+  EXPECT_GT(stats.collections, 0u);
+  EXPECT_GT(stats.bytesFreed, 0u);
+  EXPECT_GT(stats.liveBytesByKind[static_cast<size_t>(ObjectKind::ARRAY)], 10000 * sizeof(Value));
+  EXPECT_EQ(stats.bytesAllocated - stats.bytesFreed, stats.liveBytes);
+}
+
+TEST(GcStatsTest, RecordPauseKeepsTheMaximum) {
+  GcStats stats;
+  stats.recordPause(100, 50);
+  stats.recordPause(10, 20);
+  EXPECT_EQ(stats.collections, 2u);
+  EXPECT_EQ(stats.markNanos, 110u);
+  EXPECT_EQ(stats.sweepNanos, 70u);
+  EXPECT_EQ(stats.maxPauseNanos, 150u);
+  EXPECT_EQ(stats.lastPauseNanos, 30u);
+  EXPECT_DOUBLE_EQ(stats.averagePauseNanos(), 90.0);
+}
+
+TEST(GcStatsTest, JsonListsLiveTypes) {
+  GcStats stats;
+  stats.recordPause(1000, 500);
+  stats.liveObjects = 3;
+  stats.liveObjectsByKind[static_cast<size_t>(ObjectKind::STRING)] = 2;
+  stats.liveBytesByKind[static_cast<size_t>(ObjectKind::STRING)] = 64;
+  stats.liveObjectsByKind[static_cast<size_t>(ObjectKind::MAP)] = 1;
+  stats.liveBytesByKind[static_cast<size_t>(ObjectKind::MAP)] = 128;
+
+  std::string json = stats.toJson();
+  EXPECT_NE(json.find("\"collections\": 1,"), std::string::npos);
+  EXPECT_NE(json.find("\"max_pause_ns\": 1500,"), std::string::npos);
+  EXPECT_NE(json.find("\"avg_pause_ns\": 1500,"), std::string::npos);
+  EXPECT_NE(json.find("\"string\": {\"objects\": 2, \"bytes\": 64},\n"), std::string::npos);
+  EXPECT_NE(json.find("\"map\": {\"objects\": 1, \"bytes\": 128}\n"), std::string::npos);
+  EXPECT_EQ(json.find("\"array\""), std::string::npos);
+
+  EXPECT_NE(GcStats().toJson().find("\"live_by_type\": {}\n}"), std::string::npos);
+}
+
+TEST(GcStatsTest, NativeReturnsAMap) {
+  const char *source =
+      "var garbage = nil;\n"
+      "for (var i = 0; i < 3000; i = i + 1) garbage = [i];\n"
+      "var stats = gcStats();\n"
+      "print stats[\"collections\"] > 0;\n"
+      "print stats[\"live_bytes\"] > 0;\n"
+      "print stats[\"max_pause_ns\"] >= stats[\"avg_pause_ns\"];\n"
+      "print stats[\"live_by_type\"][\"array\"] > 0;\n"
+      "print stats[\"live_by_type\"][\"rope\"];\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> true\n-> true\n-> true\n-> true\n-> nil\n");
+}
+
+TEST(GcStatsTest, NativeTakesNoArguments) {
+  auto [result, output] = AsasFixture::runSourceWithError("gcStats(1);\n");
+
+  EXPECT_NE(output.find("gcStats() takes no arguments."), std::string::npos);
+}
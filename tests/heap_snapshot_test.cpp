@@ -0,0 +1,137 @@
+#include "heap_snapshot.h"
+#include "vm.h"
+#include <gtest/gtest.h>
+
+// root -> a, root -> b, a -> c, b -> c, c -> d, and a weak root -> d
+static HeapSnapshot diamond() {
+  HeapSnapshot snapshot;
+  uint32_t root = snapshot.addNode(HeapSnapshot::SYNTHETIC, "", 0);
+  uint32_t a = snapshot.addNode(HeapSnapshot::OBJECT, "A", 10);
+  uint32_t b = snapshot.addNode(HeapSnapshot::OBJECT, "B", 20);
+  uint32_t c = snapshot.addNode(HeapSnapshot::STRING, "say \"hi\"\n", 30);
+  uint32_t d = snapshot.addNode(HeapSnapshot::OBJECT, "D", 40);
+  snapshot.addNode(HeapSnapshot::OBJECT, "unreachable", 50);
+  snapshot.addEdge(root, HeapSnapshot::PROPERTY, "a", a);
+  snapshot.addEdge(root, HeapSnapshot::PROPERTY, "b", b);
+  snapshot.addEdge(root, HeapSnapshot::WEAK, "d", d);
+  snapshot.addEdge(a, HeapSnapshot::ELEMENT, 0, c);
+  snapshot.addEdge(b, HeapSnapshot::ELEMENT, 0, c);
+  snapshot.addEdge(c, HeapSnapshot::ELEMENT, 0, d);
+  return snapshot;
+}
+
+TEST(HeapSnapshotTest, DominatorsIgnoreWeakEdges) {
+  std::vector<uint32_t> dominator = diamond().dominators();
+
+  ASSERT_EQ(dominator.size(), 6u);
+  EXPECT_EQ(dominator[0], 0u);
+  EXPECT_EQ(dominator[1], 0u);
+  EXPECT_EQ(dominator[2], 0u);
+  // reached through both a and b, so only the root dominates it
+  EXPECT_EQ(dominator[3], 0u);
+  EXPECT_EQ(dominator[4], 3u);
+  EXPECT_EQ(dominator[5], UINT32_MAX);
+}
+
+TEST(HeapSnapshotTest, RetainedSizeCoversDominatedNodes) {
+  std::vector<HeapSnapshot::Retainer> retainers = diamond().biggestRetainers(2);
+
+  ASSERT_EQ(retainers.size(), 2u);
+  EXPECT_EQ(retainers[0].node, 3u);
+  EXPECT_EQ(retainers[0].retainedSize, 70u);
+  EXPECT_EQ(retainers[0].dominatedCount, 2u);
+  EXPECT_EQ(retainers[1].node, 4u);
+  EXPECT_EQ(retainers[1].retainedSize, 40u);
+}
+
+TEST(HeapSnapshotTest, JsonRoundTrips) {
+  HeapSnapshot original = diamond();
+  HeapSnapshot parsed;
+  std::string error;
+  ASSERT_TRUE(HeapSnapshot::parse(original.toJson(), parsed, error)) << error;
+
+  ASSERT_EQ(parsed.getNodes().size(), original.getNodes().size());
+  for (size_t i = 0; i < original.getNodes().size(); i++) {
+    const HeapSnapshot::Node &expected = original.getNodes()[i];
+    const HeapSnapshot::Node &node = parsed.getNodes()[i];
+    EXPECT_EQ(node.type, expected.type);
+    EXPECT_EQ(parsed.nameOf(i), original.nameOf(i));
+    EXPECT_EQ(node.id, expected.id);
+    EXPECT_EQ(node.selfSize, expected.selfSize);
+    ASSERT_EQ(node.edges.size(), expected.edges.size());
+    for (size_t e = 0; e < node.edges.size(); e++) {
+      EXPECT_EQ(node.edges[e].type, expected.edges[e].type);
+      EXPECT_EQ(node.edges[e].nameOrIndex, expected.edges[e].nameOrIndex);
+      EXPECT_EQ(node.edges[e].to, expected.edges[e].to);
+    }
+  }
+  EXPECT_EQ(parsed.summary(), original.summary());
+}
+
+TEST(HeapSnapshotTest, ParsesFieldsInAnyOrder) {
+  // the meta comes from the file: here a six field node without ids last
+  const char *json =
+      "{\"strings\": [\"\", \"big\", \"\\u00e9\"],"
+      " \"snapshot\": {\"node_count\": 2, \"meta\": {"
+      "   \"node_fields\": [\"name\", \"type\", \"self_size\", \"id\", \"edge_count\", \"trace_node_id\"],"
+      "   \"node_types\": [[\"synthetic\", \"object\"], \"string\"],"
+      "   \"edge_fields\": [\"type\", \"name_or_index\", \"to_node\"],"
+      "   \"edge_types\": [[\"property\"], \"string_or_number\", \"node\"],"
+      "   \"extra\": {\"nested\": [1, true, null]}}},"
+      " \"nodes\": [0, 0, 0, 1, 1, 0,  2, 1, 99, 3, 0, 0],"
+      " \"edges\": [0, 1, 6]}";
+  HeapSnapshot snapshot;
+  std::string error;
+  ASSERT_TRUE(HeapSnapshot::parse(json, snapshot, error)) << error;
+
+  ASSERT_EQ(snapshot.getNodes().size(), 2u);
+  EXPECT_EQ(snapshot.getNodes()[0].type, HeapSnapshot::SYNTHETIC);
+  EXPECT_EQ(snapshot.getNodes()[1].type, HeapSnapshot::OBJECT);
+  EXPECT_EQ(snapshot.getNodes()[1].selfSize, 99u);
+  EXPECT_EQ(snapshot.nameOf(1), "\xc3\xa9");
+  ASSERT_EQ(snapshot.getNodes()[0].edges.size(), 1u);
+  EXPECT_EQ(snapshot.getNodes()[0].edges[0].type, HeapSnapshot::PROPERTY);
+  EXPECT_EQ(snapshot.getNodes()[0].edges[0].to, 1u);
+}
+
+TEST(HeapSnapshotTest, RejectsWhatIsNotASnapshot) {
+  HeapSnapshot snapshot;
+  std::string error;
+  EXPECT_FALSE(HeapSnapshot::parse("[1, 2", snapshot, error));
+  EXPECT_FALSE(HeapSnapshot::parse("{\"nodes\": [1]}", snapshot, error));
+  EXPECT_NE(error.find("meta"), std::string::npos);
+}
+
+TEST(HeapSnapshotTest, VmSnapshotFindsTheRetainingGlobal) {
+  const char *source =
+      "var big = float64Array(10000);\n"
+      "var small = [\"x\"];\n"
+      "var garbage = nil;\n"
+      "for (var i = 0; i < 10; i = i + 1) garbage = [i];\n";
+  VM vm;
+  ASSERT_EQ(vm.interpret(source), INTERPRET_OK);
+  HeapSnapshot snapshot = vm.takeHeapSnapshot();
+
+  std::vector<HeapSnapshot::Retainer> retainers = snapshot.biggestRetainers(1);
+  ASSERT_EQ(retainers.size(), 1u);
+  EXPECT_EQ(snapshot.describe(retainers[0].node), "object Float64Array");
+  EXPECT_EQ(snapshot.describe(retainers[0].dominator), "(globals)");
+  EXPECT_GE(retainers[0].retainedSize, 10000 * sizeof(double));
+
+  // the global is the edge that leads to it
+  const HeapSnapshot::Node &globals = snapshot.getNodes()[retainers[0].dominator];
+  bool found = false;
+  for (const HeapSnapshot::Edge &edge : globals.edges)
+    if (edge.to == retainers[0].node)
+      found = edge.type == HeapSnapshot::PROPERTY && snapshot.getStrings()[edge.nameOrIndex] == "big";
+  EXPECT_TRUE(found);
+
+  // every tracked object has a node, the overwritten arrays too
+  GcStats stats = vm.getGcStats();
+  size_t objects = 0;
+  for (const HeapSnapshot::Node &node : snapshot.getNodes())
+    if (node.type != HeapSnapshot::SYNTHETIC) objects++;
+  EXPECT_GE(objects, stats.liveObjects);
+  std::string summary = snapshot.summary(5);
+  EXPECT_NE(summary.find("object Float64Array <- (globals)"), std::string::npos);
+}
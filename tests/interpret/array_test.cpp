@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "../asas_fixture.h"
+
+TEST(ArrayTest, LiteralIndexAndLength) {
+  const char *source =
+      "var a = [1, \"two\", true, nil];\n"
+      "print a[0];\n"
+      "print a[1];\n"
+      "print a.length;\n"
+      "print a;\n"
+      "print [];\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 1.00\n-> two\n-> 4.00\n-> [1.00, two, true, nil]\n-> []\n");
+}
+
+TEST(ArrayTest, SetIndexIsAnExpression) {
+  const char *source =
+      "var a = [0, 0, 0];\n"
+      "print a[1] = 5;\n"
+      "a[2] = a[1] + 1;\n"
+      "print a;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 5.00\n-> [0.00, 5.00, 6.00]\n");
+}
+
+TEST(ArrayTest, PushPopAndNesting) {
+  const char *source =
+      "var grid = [];\n"
+      "for (var i = 0; i < 3; i = i + 1) {\n"
+      "  var row = [];\n"
+      "  for (var j = 0; j < 3; j = j + 1) push(row, i * 3 + j);\n"
+      "  push(grid, row);\n"
+      "}\n"
+      "print grid[2][1];\n"
+      "print pop(grid);\n"
+      "print grid.length;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 7.00\n-> [6.00, 7.00, 8.00]\n-> 2.00\n");
+}
+
+TEST(ArrayTest, LargeArraySurvivesCollections) {
+  const char *source =
+      "var a = [];\n"
+      "for (var i = 0; i < 20000; i = i + 1) push(a, \"item \" + i);\n"
+      "var total = 0;\n"
+      "for (var i = 0; i < a.length; i = i + 1) total = total + a[i].length;\n"
+      "print a[19999];\n"
+      "print total;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> item 19999.00\n-> 248890.00\n");
+}
+
+TEST(ArrayTest, SelfReferencePrintsEllipsis) {
+  const char *source =
+      "var a = [1];\n"
+      "push(a, a);\n"
+      "print a;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> [1.00, [...]]\n");
+}
+
+TEST(ArrayTest, IndexOutOfBounds) {
+  auto [result, output] = AsasFixture::runSourceWithError("var a = [1, 2]; print a[2];\n");
+
+  EXPECT_NE(output.find("Array index 2 out of bounds for length 2."), std::string::npos);
+}
+
+TEST(ArrayTest, FractionalIndex) {
+  auto [result, output] = AsasFixture::runSourceWithError("var a = [1, 2]; a[0.5] = 3;\n");
+
+  EXPECT_NE(output.find("out of bounds"), std::string::npos);
+}
+
+TEST(ArrayTest, IndexNonArray) {
+  auto [result, output] = AsasFixture::runSourceWithError("var n = 3; print n[0];\n");
+
+  EXPECT_NE(output.find("Can only index arrays and maps."), std::string::npos);
+}
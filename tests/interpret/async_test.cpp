@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include "../asas_fixture.h"
+
+TEST(AsyncTest, TasksInterleaveOnTimers) {
+  const char *source =
+      "func slow() { delay(0.03); print \"slow\"; }\n"
+      "func fast() { delay(0.01); print \"fast\"; }\n"
+      "spawn(slow);\n"
+      "spawn(fast);\n"
+      "print \"main done\";\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> main done\n-> fast\n-> slow\n");
+}
+
+TEST(AsyncTest, DelaysOverlapInsteadOfAddingUp) {
+  const char *source =
+      "func sleeper() { delay(0.05); }\n"
+      "for (var i = 0; i < 100; i = i + 1) { spawn(sleeper); }\n";
+
+  auto start = std::chrono::steady_clock::now();
+  AsasFixture::runSourceWithSuccess(source);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_LT(elapsed, std::chrono::seconds(1));
+}
+
+TEST(AsyncTest, MainScriptWaitRunsTasks) {
+  const char *source =
+      "func worker() { print \"worker\"; delay(0); print \"worker again\"; }\n"
+      "spawn(worker);\n"
+      "delay(0.02);\n"
+      "print \"main after delay\";\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> worker\n-> worker again\n-> main after delay\n");
+}
+
+TEST(AsyncTest, YieldingTasksTakeTurns) {
+  const char *source =
+      "func loop(name) {\n"
+      "  for (var i = 0; i < 2; i = i + 1) { print name; yield; }\n"
+      "}\n"
+      "func a() { loop(\"a\"); }\n"
+      "func b() { loop(\"b\"); }\n"
+      "spawn(a);\n"
+      "spawn(b);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> a\n-> b\n-> a\n-> b\n");
+}
+
+TEST(AsyncTest, CannotResumeWaitingFiber) {
+  const char *source =
+      "func waits() { delay(1); }\n"
+      "var f = fiber(waits);\n"
+      "resume(f);\n"
+      "resume(f);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithError(source);
+
+  EXPECT_NE(output.find("Fiber is waiting on an async call."), std::string::npos);
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "../asas_fixture.h"
+
+TEST(FiberTest, YieldAndResume) {
+  const char *source =
+      "func count() {\n"
+      "  yield 1;\n"
+      "  yield 2;\n"
+      "  return 3;\n"
+      "}\n"
+      "var f = fiber(count);\n"
+      "print resume(f);\n"
+      "print done(f);\n"
+      "print resume(f);\n"
+      "print resume(f);\n"
+      "print done(f);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 1.00\n-> false\n-> 2.00\n-> 3.00\n-> true\n");
+}
+
+TEST(FiberTest, ResumePassesValuesIn) {
+  const char *source =
+      "func accumulate(first) {\n"
+      "  var total = first;\n"
+      "  while (true) {\n"
+      "    total = total + (yield total);\n"
+      "  }\n"
+      "}\n"
+      "var f = fiber(accumulate);\n"
+      "print resume(f, 10);\n"
+      "print resume(f, 5);\n"
+      "print resume(f, 2);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 10.00\n-> 15.00\n-> 17.00\n");
+}
+
+TEST(FiberTest, FibersKeepTheirOwnLocalsAndFrames) {
+  const char *source =
+      "func inner(n) {\n"
+      "  yield n;\n"
+      "  return n * 2;\n"
+      "}\n"
+      "func worker(start) {\n"
+      "  var value = inner(start);\n"
+      "  yield value;\n"
+      "  return \"done \" + start;\n"
+      "}\n"
+      "var a = fiber(worker);\n"
+      "var b = fiber(worker);\n"
+      "print resume(a, 1);\n"
+      "print resume(b, 100);\n"
+      "print resume(a);\n"
+      "print resume(b);\n"
+      "print resume(a);\n"
+      "print resume(b);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output,
+            "-> 1.00\n-> 100.00\n-> 2.00\n-> 200.00\n"
+            "-> done 1.00\n-> done 100.00\n");
+}
+
+TEST(FiberTest, NestedFibersYieldToTheirResumer) {
+  const char *source =
+      "func child() {\n"
+      "  yield \"child\";\n"
+      "}\n"
+      "func parent() {\n"
+      "  var c = fiber(child);\n"
+      "  yield resume(c) + \" via parent\";\n"
+      "}\n"
+      "var p = fiber(parent);\n"
+      "print resume(p);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> child via parent\n");
+}
+
+TEST(FiberTest, ClosureOverFiberLocalOutlivesFiber) {
+  const char *source =
+      "var getter;\n"
+      "func body() {\n"
+      "  var secret = \"kept\";\n"
+      "  func get() { return secret; }\n"
+      "  getter = get;\n"
+      "  yield;\n"
+      "}\n"
+      "var f = fiber(body);\n"
+      "resume(f);\n"
+      "f = nil;\n"
+      "var s = \"\";\n"
+      "for (var i = 0; i < 3000; i = i + 1) { s = s + \"x\"; }\n"
+      "print getter();\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> kept\n");
+}
+
+TEST(FiberTest, ThousandsOfFibers) {
+  const char *source =
+      "func ticker(id) {\n"
+      "  var n = 0;\n"
+      "  while (true) { n = n + 1; yield n; }\n"
+      "}\n"
+      "var total = 0;\n"
+      "for (var i = 0; i < 2000; i = i + 1) {\n"
+      "  var f = fiber(ticker);\n"
+      "  resume(f, i);\n"
+      "  total = total + resume(f);\n"
+      "}\n"
+      "print total;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 4000.00\n");
+}
+
+TEST(FiberTest, YieldOutsideFiber) {
+  auto [result, output] = AsasFixture::runSourceWithError("yield 1;\n");
+
+  EXPECT_NE(output.find("Can't yield outside a fiber."), std::string::npos);
+}
+
+TEST(FiberTest, ResumeFinishedFiber) {
+  const char *source =
+      "func once() { return 1; }\n"
+      "var f = fiber(once);\n"
+      "resume(f);\n"
+      "resume(f);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithError(source);
+
+  EXPECT_NE(output.find("Cannot resume a finished fiber."), std::string::npos);
+}
+
+TEST(FiberTest, ErrorInsideFiberUnwindsToMain) {
+  const char *source =
+      "func broken() { yield 1; return missing; }\n"
+      "var f = fiber(broken);\n"
+      "resume(f);\n"
+      "resume(f);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithError(source);
+
+  EXPECT_NE(output.find("Undefined variable 'missing'."), std::string::npos);
+}
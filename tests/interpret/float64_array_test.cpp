@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include "../asas_fixture.h"
+
+TEST(Float64ArrayTest, CreateIndexAndLength) {
+  const char *source =
+      "var a = float64Array(3);\n"
+      "a[1] = 2.5;\n"
+      "print a;\n"
+      "print a.length;\n"
+      "print float64Array([1, 2, 3])[2];\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> Float64Array[0.00, 2.50, 0.00]\n-> 3.00\n-> 3.00\n");
+}
+
+TEST(Float64ArrayTest, BulkKernels) {
+  const char *source =
+      "var a = float64Array(1000);\n"
+      "for (var i = 0; i < a.length; i = i + 1) a[i] = i;\n"
+      "var b = float64Array(1000);\n"
+      "for (var i = 0; i < b.length; i = i + 1) b[i] = 2;\n"
+      "print f64Sum(a);\n"
+      "print f64Dot(a, b);\n"
+      "print f64Min(a);\n"
+      "print f64Max(a);\n"
+      "f64Scale(a, 3);\n"
+      "print a[999];\n"
+      "f64Add(a, b);\n"
+      "print a[0];\n"
+      "print f64PrefixSum(float64Array([1, 2, 3, 4, 5]));\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output,
+            "-> 499500.00\n-> 999000.00\n-> 0.00\n-> 999.00\n-> 2997.00\n-> 2.00\n"
+            "-> Float64Array[1.00, 3.00, 6.00, 10.00, 15.00]\n");
+}
+
+TEST(Float64ArrayTest, StoresOnlyNumbers) {
+  auto [result, output] = AsasFixture::runSourceWithError("var a = float64Array(2); a[0] = \"x\";\n");
+
+  EXPECT_NE(output.find("Float64Array elements must be numbers."), std::string::npos);
+}
+
+TEST(Float64ArrayTest, DotLengthMismatch) {
+  auto [result, output] = AsasFixture::runSourceWithError(
+      "print f64Dot(float64Array(2), float64Array(3));\n");
+
+  EXPECT_NE(output.find("f64Dot() arrays must have the same length."), std::string::npos);
+}
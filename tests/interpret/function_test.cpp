@@ -187,3 +187,19 @@ TEST(FunctionTest, CallFunctionWithExpression) {
 
   EXPECT_EQ(output, "-> 29.00\n");
 }
+
+TEST(FunctionTest, DefinitionsSurviveAcrossInterpretCalls) {
+  VM vm;
+  testing::internal::CaptureStdout();
+  EXPECT_EQ(vm.interpret("var total = 0;"), INTERPRET_OK);
+  EXPECT_EQ(vm.interpret("func add(x) { total = total + x; return total; }"), INTERPRET_OK);
+  EXPECT_EQ(vm.interpret("print add(2);"), INTERPRET_OK);
+  testing::internal::CaptureStderr();
+  EXPECT_EQ(vm.interpret("print add(\"oops\") - 1;"), INTERPRET_RUNTIME_ERROR);
+  testing::internal::GetCapturedStderr();
+  EXPECT_EQ(vm.interpret("print add(3);"), INTERPRET_OK);
+  std::string output = testing::internal::GetCapturedStdout();
+
+  EXPECT_EQ(output, "-> 2.00\n-> 5.00\n");
+  EXPECT_EQ(vm.stackSize(), 0);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "../asas_fixture.h"
+
+TEST(MapTest, LiteralGetAndLength) {
+  const char *source =
+      "var m = {\"one\": 1, 2: \"two\", true: nil};\n"
+      "print m[\"one\"];\n"
+      "print m[2];\n"
+      "print m[true];\n"
+      "print m[\"missing\"];\n"
+      "print m.length;\n"
+      "print {\"k\": [1]};\n"
+      "print {};\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 1.00\n-> two\n-> nil\n-> nil\n-> 3.00\n-> {k: [1.00]}\n-> {}\n");
+}
+
+TEST(MapTest, SetOverwritesAndIsAnExpression) {
+  const char *source =
+      "var m = {};\n"
+      "print m[\"a\"] = 1;\n"
+      "m[\"a\"] = m[\"a\"] + 1;\n"
+      "m[-0] = \"zero\";\n"
+      "print m[\"a\"];\n"
+      "print m[0];\n"
+      "print m.length;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 1.00\n-> 2.00\n-> zero\n-> 2.00\n");
+}
+
+TEST(MapTest, RopeKeysMatchFlatStrings) {
+  const char *source =
+      "var m = {};\n"
+      "var prefix = \"ke\";\n"
+      "m[prefix + \"y\"] = 42;\n"
+      "print m[\"key\"];\n"
+      "print has(m, \"k\" + \"ey\");\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 42.00\n-> true\n");
+}
+
+TEST(MapTest, HasRemoveAndKeys) {
+  const char *source =
+      "var m = {\"x\": 1, \"y\": 2};\n"
+      "print remove(m, \"x\");\n"
+      "print remove(m, \"x\");\n"
+      "print has(m, \"x\");\n"
+      "print has(m, \"y\");\n"
+      "print keys(m);\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> true\n-> false\n-> false\n-> true\n-> [y]\n");
+}
+
+TEST(MapTest, LargeMapSurvivesCollections) {
+  const char *source =
+      "var m = {};\n"
+      "for (var i = 0; i < 20000; i = i + 1) m[\"item \" + i] = i;\n"
+      "for (var i = 0; i < 20000; i = i + 2) remove(m, \"item \" + i);\n"
+      "var total = 0;\n"
+      "var k = keys(m);\n"
+      "for (var i = 0; i < k.length; i = i + 1) total = total + m[k[i]];\n"
+      "print m.length;\n"
+      "print total;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> 10000.00\n-> 100000000.00\n");
+}
+
+TEST(MapTest, SelfReferencePrintsEllipsis) {
+  const char *source =
+      "var m = {};\n"
+      "m[\"self\"] = m;\n"
+      "print m;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> {self: {...}}\n");
+}
+
+TEST(MapTest, NaNKey) {
+  const char *source =
+      "var inf = 1;\n"
+      "for (var i = 0; i < 400; i = i + 1) inf = inf * 10;\n"
+      "var m = {};\n"
+      "m[inf - inf] = 1;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithError(source);
+
+  EXPECT_NE(output.find("Map key can't be NaN."), std::string::npos);
+}
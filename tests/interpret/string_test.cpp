@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include "../asas_fixture.h"
+
+TEST(StringTest, LongConcatenationLoop) {
+  const char *source =
+      "var str = \"\";\n"
+      "var other = \"\";\n"
+      "for (var i = 0; i < 3000; i = i + 1) {\n"
+      "  str = str + \"ab\";\n"
+      "}\n"
+      "for (var i = 0; i < 2000; i = i + 1) {\n"
+      "  other = other + \"abab\" + \"ab\";\n"
+      "  i = i + 1;\n"
+      "}\n"
+      "print str == other;\n"
+      "print str == other + \"ab\";\n"
+      "print str + \"c\" == other + \"c\";\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> true\n-> false\n-> true\n");
+}
+
+TEST(StringTest, LongPrependLoop) {
+  const char *source =
+      "var str = \"\";\n"
+      "var other = \"\";\n"
+      "for (var i = 0; i < 3000; i = i + 1) {\n"
+      "  str = \"ab\" + str;\n"
+      "  other = other + \"ab\";\n"
+      "}\n"
+      "print str == other;\n"
+      "var chunk = \"0123456789012345678901234567890123456789012345678901234567890123456789\";\n"
+      "var deep = \"\";\n"
+      "var flat = \"\";\n"
+      "for (var i = 0; i < 3000; i = i + 1) {\n"
+      "  deep = chunk + deep;\n"
+      "  flat = flat + chunk;\n"
+      "}\n"
+      "print \"<\" + deep == \"<\" + flat;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> true\n-> true\n");
+}
+
+TEST(StringTest, PrintConcatenatedLongString) {
+  const char *source =
+      "var digits = \"0123456789012345678901234567890123456789\";\n"
+      "var line = digits + \"|\" + digits;\n"
+      "print line + \"|\" + line;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  std::string digits = "0123456789012345678901234567890123456789";
+  std::string line = digits + "|" + digits;
+  EXPECT_EQ(output, "-> " + line + "|" + line + "\n");
+}
+
+TEST(StringTest, ConcatenateNumbers) {
+  const char *source =
+      "print \"fib(\" + 10 + \") = \" + 55;\n"
+      "print \"ratio: \" + 2 / 3;\n"
+      "print \"negative: \" + -1.5;\n";
+
+  auto [result, output] = AsasFixture::runSourceWithSuccess(source);
+
+  EXPECT_EQ(output, "-> fib(10.00) = 55.00\n-> ratio: 0.67\n-> negative: -1.50\n");
+}
@@ -0,0 +1,70 @@
+#include "script_runner.h"
+#include "object.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(IsolateTest, ObjectsAreCountedPerIsolate) {
+  Isolate isolate;
+  {
+    VM vm(isolate);
+    vm.setOutputSink(std::make_unique<MemoryOutputSink>());
+    ASSERT_EQ(vm.interpret("var s = \"kept\" + \" alive\";"), INTERPRET_OK);
+
+    int strings = 0;
+    {
+      IsolateScope isolateScope(isolate);
+      strings = AsasString::getRefCountObjects();
+    }
+    EXPECT_GT(strings, 0);
+    // nothing leaked into this thread's own isolate
+    EXPECT_EQ(AsasString::getRefCountObjects(), 0);
+  }
+  IsolateScope isolateScope(isolate);
+  EXPECT_EQ(AsasObject::getRefCountObjects(), 0);
+}
+
+TEST(IsolateTest, VmsRunOnSeparateThreads) {
+  std::vector<std::thread> threads;
+  std::vector<std::string> outputs(4);
+  for (size_t i = 0; i < outputs.size(); i++) {
+    threads.emplace_back([i, &outputs]() {
+      VM vm;
+      auto sink = std::make_unique<MemoryOutputSink>();
+      MemoryOutputSink *memory = sink.get();
+      vm.setOutputSink(std::move(sink));
+      std::string source = "var s = \"\"; for (var i = 0; i < 2000; i = i + 1) { s = s + \"x\"; }"
+                           "print s == s; print " + std::to_string(i) + ";";
+      EXPECT_EQ(vm.interpret(source.c_str()), INTERPRET_OK);
+      outputs[i] = memory->getContents();
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+
+  for (size_t i = 0; i < outputs.size(); i++)
+    EXPECT_EQ(outputs[i], "-> true\n-> " + std::to_string(i) + ".00\n");
+}
+
+TEST(IsolateTest, RunnerExecutesScriptsConcurrently) {
+  std::vector<std::string> sources;
+  for (int i = 0; i < 32; i++) {
+    sources.push_back(
+        "func fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+        "var name = \"job \" + " + std::to_string(i) + ";\n"
+        "print name; print fib(" + std::to_string(i % 12) + ");\n");
+  }
+  sources.push_back("print undefinedVariable;");
+
+  ScriptRunner runner(4);
+  testing::internal::CaptureStderr();
+  std::vector<ScriptResult> results = runner.runAll(sources);
+  testing::internal::GetCapturedStderr();
+
+  ASSERT_EQ(results.size(), sources.size());
+  int fib[12] = {0, 1, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89};
+  for (int i = 0; i < 32; i++) {
+    EXPECT_EQ(results[i].status, INTERPRET_OK);
+    EXPECT_EQ(results[i].output,
+              "-> job " + std::to_string(i) + ".00\n-> " + std::to_string(fib[i % 12]) + ".00\n");
+  }
+  EXPECT_EQ(results.back().status, INTERPRET_RUNTIME_ERROR);
+}
@@ -0,0 +1,48 @@
+#include "opcode_profiler.h"
+#include "vm.h"
+#include <gtest/gtest.h>
+
+TEST(OpcodeProfilerTest, CountsOpcodesAndPairs) {
+  OpcodeProfiler profiler;
+  for (int i = 0; i < 100; i++) {
+    profiler.instruction(OP_GET_LOCAL);
+    profiler.instruction(OP_CONSTANT);
+    profiler.instruction(OP_ADD);
+  }
+  profiler.interrupt();
+  profiler.instruction(OP_RETURN);
+
+  EXPECT_EQ(profiler.getTotalCount(), 301u);
+  EXPECT_EQ(profiler.getCount(OP_ADD), 100u);
+  EXPECT_EQ(profiler.getPairCount(OP_GET_LOCAL, OP_CONSTANT), 100u);
+  EXPECT_EQ(profiler.getPairCount(OP_ADD, OP_GET_LOCAL), 99u);
+  // the interrupt broke the sequence
+  EXPECT_EQ(profiler.getPairCount(OP_ADD, OP_RETURN), 0u);
+
+  uint64_t samples = 0;
+  for (int opcode = 0; opcode < OP_COUNT; opcode++) samples += profiler.getSampleCount(opcode);
+  EXPECT_EQ(samples, 300u / OPCODE_PROFILE_SAMPLE_PERIOD);
+}
+
+TEST(OpcodeProfilerTest, JsonListsOpcodesByCount) {
+  OpcodeProfiler profiler;
+  profiler.instruction(OP_NIL);
+  profiler.instruction(OP_POP);
+  profiler.instruction(OP_POP);
+
+  std::string json = profiler.toJson();
+  size_t pop = json.find("\"name\": \"OP_POP\", \"class\": \"stack\", \"count\": 2");
+  size_t nil = json.find("\"name\": \"OP_NIL\"");
+  ASSERT_NE(pop, std::string::npos);
+  ASSERT_NE(nil, std::string::npos);
+  EXPECT_LT(pop, nil);
+  EXPECT_NE(json.find("{\"first\": \"OP_NIL\", \"second\": \"OP_POP\", \"count\": 1}"), std::string::npos);
+}
+
+#ifdef DEBUG_PROFILE_OPCODES
+TEST(OpcodeProfilerTest, VmFeedsTheProfiler) {
+  VM vm;
+  ASSERT_EQ(vm.interpret("var i = 0; while (i < 10) i = i + 1;"), INTERPRET_OK);
+  EXPECT_EQ(vm.getOpcodeProfiler().getCount(OP_LOOP), 10u);
+}
+#endif
@@ -0,0 +1,66 @@
+#include "vm.h"
+#include <gtest/gtest.h>
+
+TEST(OutputSinkTest, PrintGoesToInstalledSink) {
+  VM vm;
+  auto sink = std::make_unique<MemoryOutputSink>();
+  MemoryOutputSink *memory = sink.get();
+  vm.setOutputSink(std::move(sink));
+
+  InterpretResult result = vm.interpret("print 1 + 2; print \"asas\"; print nil;");
+
+  EXPECT_EQ(result, INTERPRET_OK);
+  EXPECT_EQ(memory->getContents(), "-> 3.00\n-> asas\n-> nil\n");
+}
+
+TEST(OutputSinkTest, FlushesWhenBufferIsFull) {
+  std::vector<std::string> blocks;
+  CallbackOutputSink sink([&blocks](const char *chars, size_t length) {
+    blocks.emplace_back(chars, length);
+  }, 8);
+
+  sink.write("abcde");
+  sink.write("fgh");
+  EXPECT_TRUE(blocks.empty());
+  sink.put('i');
+  ASSERT_EQ(blocks.size(), 1u);
+  EXPECT_EQ(blocks[0], "abcdefgh");
+
+  sink.write("0123456789");
+  ASSERT_EQ(blocks.size(), 3u);
+  EXPECT_EQ(blocks[1], "i");
+  EXPECT_EQ(blocks[2], "0123456789");
+}
+
+TEST(OutputSinkTest, LineBufferedFlushesEveryLine) {
+  std::vector<std::string> blocks;
+  CallbackOutputSink sink([&blocks](const char *chars, size_t length) {
+    blocks.emplace_back(chars, length);
+  });
+  sink.setLineBuffered(true);
+
+  sink.write("one\ntwo\nthree");
+  ASSERT_EQ(blocks.size(), 2u);
+  EXPECT_EQ(blocks[0], "one\n");
+  EXPECT_EQ(blocks[1], "two\n");
+
+  sink.flush();
+  ASSERT_EQ(blocks.size(), 3u);
+  EXPECT_EQ(blocks[2], "three");
+}
+
+TEST(OutputSinkTest, RuntimeErrorFlushesPendingOutput) {
+  std::string flushed;
+  VM vm;
+  vm.setOutputSink(std::make_unique<CallbackOutputSink>([&flushed](const char *chars, size_t length) {
+    flushed.append(chars, length);
+  }));
+
+  testing::internal::CaptureStderr();
+  InterpretResult result = vm.interpret("print \"before\"; print undefinedVariable;");
+  std::string errors = testing::internal::GetCapturedStderr();
+
+  EXPECT_EQ(result, INTERPRET_RUNTIME_ERROR);
+  EXPECT_EQ(flushed, "-> before\n");
+  EXPECT_NE(errors.find("Undefined variable 'undefinedVariable'."), std::string::npos);
+}
@@ -0,0 +1,72 @@
+#include "sampling_profiler.h"
+#include "vm.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+static const char *FIB_SOURCE =
+    "func fib(n) {\n"
+    "  if (n < 2) return n;\n"
+    "  return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "fib(15);\n";
+
+// sums the counts of the folded lines whose stack starts with `prefix`
+static uint64_t countSamples(const std::string &folded, const std::string &prefix) {
+  std::istringstream lines(folded);
+  uint64_t total = 0;
+  for (std::string line; std::getline(lines, line);) {
+    if (line.rfind(prefix, 0) != 0) continue;
+    total += std::stoull(line.substr(line.rfind(' ') + 1));
+  }
+  return total;
+}
+
+TEST(SamplingProfilerTest, InstructionTicksFoldTheCallStack) {
+  SamplingProfiler profiler(SamplingProfiler::INSTRUCTIONS, 100);
+  VM vm;
+  vm.setSamplingProfiler(&profiler);
+  ASSERT_TRUE(profiler.start());
+  ASSERT_EQ(vm.interpret(FIB_SOURCE), INTERPRET_OK);
+  profiler.stop();
+
+  std::string folded = profiler.toFolded();
+  EXPECT_GT(profiler.getSampleCount(), 100u);
+  EXPECT_EQ(countSamples(folded, ""), profiler.getSampleCount());
+  // nearly all the time is spent in fib, called from line 5 of the script
+  EXPECT_GT(countSamples(folded, "<script>:5;fib:"), profiler.getSampleCount() * 9 / 10);
+  EXPECT_NE(folded.find("<script>:5;fib:3;fib:"), std::string::npos);
+  vm.setSamplingProfiler(nullptr);
+}
+
+TEST(SamplingProfilerTest, WithoutLinesFramesMerge) {
+  SamplingProfiler profiler(SamplingProfiler::INSTRUCTIONS, 50);
+  profiler.setIncludeLines(false);
+  VM vm;
+  vm.setSamplingProfiler(&profiler);
+  profiler.start();
+  ASSERT_EQ(vm.interpret(FIB_SOURCE), INTERPRET_OK);
+
+  std::string folded = profiler.toFolded();
+  EXPECT_EQ(folded.find(':'), std::string::npos);
+  EXPECT_NE(folded.find("<script>;fib;fib "), std::string::npos);
+  vm.setSamplingProfiler(nullptr);
+}
+
+TEST(SamplingProfilerTest, TimerSamplesCpuTime) {
+  SamplingProfiler profiler(SamplingProfiler::TIMER, 1000);
+  SamplingProfiler other(SamplingProfiler::TIMER, 1000);
+  VM vm;
+  vm.setSamplingProfiler(&profiler);
+  ASSERT_TRUE(profiler.start());
+  // the timer is process-wide
+  EXPECT_FALSE(other.start());
+  ASSERT_EQ(vm.interpret("var total = 0;\n"
+                         "for (var i = 0; i < 500000; i = i + 1) total = total + i;\n"),
+            INTERPRET_OK);
+  profiler.stop();
+
+  EXPECT_GT(profiler.getSampleCount(), 0u);
+  EXPECT_TRUE(other.start());
+  other.stop();
+  vm.setSamplingProfiler(nullptr);
+}
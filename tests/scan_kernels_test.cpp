@@ -0,0 +1,122 @@
+#include "scan_kernels.h"
+#include "scanner.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+static std::vector<const ScanKernels*> vectorKernels() {
+  std::vector<const ScanKernels*> tables;
+  for (SimdLevel level : {SimdLevel::SSE4_2, SimdLevel::AVX2})
+    if (const ScanKernels *kernels = scanKernelsFor(level)) tables.push_back(kernels);
+  return tables;
+}
+
+// Runs of every kind and length, ending at every offset of a 32 byte block,
+// with the end of the span right after them or one byte later.
+TEST(ScanKernelsTest, VectorKernelsMatchScalar) {
+  const ScanKernels *scalar = scanKernelsFor(SimdLevel::SCALAR);
+  ASSERT_NE(scalar, nullptr);
+  const std::string fills[] = {" \t\r\n", "aZ_09y", "0123456789", "x \n\"", "ab\n\r\t\"", "\xc3\xa9\x80 ",
+                               std::string("a\0\n", 3)};
+  const char *ends[] = {"", "\"", "\n", "+", "a", " ", "9", "\xff"};
+
+  for (const ScanKernels *kernels : vectorKernels()) {
+    SCOPED_TRACE(kernels->name);
+    for (const std::string &fill : fills) {
+      for (const char *stop : ends) {
+        for (size_t offset = 0; offset < 32; offset++) {
+          for (size_t length : {0, 1, 2, 15, 16, 17, 31, 32, 33, 70}) {
+            // a buffer of its own, so the runs start at every alignment
+            std::string source(offset, '#');
+            for (size_t i = 0; i < length; i++) source += fill[i % fill.size()];
+            source += stop;
+            for (size_t cut : {length, source.size() - offset}) {
+              const char *p = source.data() + offset;
+              const char *end = p + cut;
+              SCOPED_TRACE(std::string(p, cut));
+
+              int expectedLine = 0, line = 0;
+              EXPECT_EQ(kernels->skipBlanks(p, end, &line), scalar->skipBlanks(p, end, &expectedLine));
+              EXPECT_EQ(line, expectedLine);
+              EXPECT_EQ(kernels->skipIdentifier(p, end), scalar->skipIdentifier(p, end));
+              EXPECT_EQ(kernels->skipDigits(p, end), scalar->skipDigits(p, end));
+              expectedLine = line = 0;
+              EXPECT_EQ(kernels->findQuote(p, end, &line), scalar->findQuote(p, end, &expectedLine));
+              EXPECT_EQ(line, expectedLine);
+              EXPECT_EQ(kernels->findNewline(p, end), scalar->findNewline(p, end));
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// The source ends right before an unmapped page, with no terminator: no
+// kernel, and no Scanner, may touch it.
+TEST(ScanKernelsTest, StopAtThePageEnd) {
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  char *memory = static_cast<char*>(mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  ASSERT_NE(memory, MAP_FAILED);
+  ASSERT_EQ(mprotect(memory + page, page, PROT_NONE), 0);
+  char *end = memory + page;
+
+  std::vector<const ScanKernels*> tables = vectorKernels();
+  tables.push_back(scanKernelsFor(SimdLevel::SCALAR));
+  for (const char *fill : {"  \n", "abc", "123", "x\ny"}) {
+    for (size_t length = 0; length < 40; length++) {
+      char *p = end - length;
+      for (size_t i = 0; i < length; i++) p[i] = fill[i % 3];
+      for (const ScanKernels *kernels : tables) {
+        int line = 0;
+        EXPECT_LE(kernels->skipBlanks(p, end, &line), end);
+        EXPECT_LE(kernels->skipIdentifier(p, end), end);
+        EXPECT_LE(kernels->skipDigits(p, end), end);
+        EXPECT_EQ(kernels->findQuote(p, end, &line), end);
+        EXPECT_LE(kernels->findNewline(p, end), end);
+      }
+    }
+  }
+
+  // every kind of token, cut off by the end of the page
+  for (const char *source : {"print 12.5", "x = 12.", "a >", "// comment", "\"open", "name_long_enough_for_a_vector_block"}) {
+    size_t length = strlen(source);
+    memcpy(end - length, source, length);
+    for (const ScanKernels *kernels : tables) {
+      Scanner scanner(end - length, length, *kernels);
+      Token token;
+      do token = scanner.scanToken();
+      while (token.type != TOKEN_EOF);
+    }
+  }
+  munmap(memory, 2 * page);
+}
+
+TEST(ScanKernelsTest, ScannerTokensMatchScalar) {
+  std::string source;
+  for (int i = 0; i < 20; i++) {
+    source += "// a comment that is long enough to span a few vector blocks " + std::to_string(i) + "\n";
+    source += "var identifier_with_a_long_name" + std::to_string(i) + " = 1234567890123.25;\n";
+    source += "print \"a string\nover two lines and " + std::string(i, 'x') + "\";\n";
+    source += std::string(i, ' ') + "\t\r\n";
+  }
+  source += "\"unterminated";
+
+  for (const ScanKernels *kernels : vectorKernels()) {
+    SCOPED_TRACE(kernels->name);
+    Scanner expected(source.c_str(), *scanKernelsFor(SimdLevel::SCALAR));
+    Scanner scanner(source.c_str(), *kernels);
+    for (;;) {
+      Token want = expected.scanToken();
+      Token token = scanner.scanToken();
+      ASSERT_EQ(token.type, want.type);
+      ASSERT_EQ(std::string(token.start, token.length), std::string(want.start, want.length));
+      ASSERT_EQ(token.line, want.line);
+      if (want.type == TOKEN_EOF) break;
+    }
+  }
+}
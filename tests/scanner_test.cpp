@@ -81,3 +81,42 @@ TEST(ScannerTest, KeywordsTokens) {
   }
   EXPECT_EQ(scanner.scanToken().type, TOKEN_EOF);
 }
+
+// Same length, first and last character as a keyword, or a keyword with a
+// character more or less: all plain identifiers.
+TEST(ScannerTest, KeywordLookalikesAreIdentifiers) {
+  const char *source =
+      "resume yield ard cless elze fulse fxr fanc iff nal o pront rethrn "
+      "suler tis trie vbr whale yiild ands retur _and And a returns x";
+  Scanner scanner(source);
+  EXPECT_EQ(scanner.scanToken().type, TOKEN_RESUME);
+  EXPECT_EQ(scanner.scanToken().type, TOKEN_YIELD);
+  for (;;) {
+    Token token = scanner.scanToken();
+    if (token.type == TOKEN_EOF) break;
+    EXPECT_EQ(token.type, TOKEN_IDENTIFIER) << std::string(token.start, token.length);
+  }
+}
+
+// A span cut out of a bigger buffer: what follows it is not scanned, and a
+// NUL inside it is just a character.
+TEST(ScannerTest, ScansASpanWithoutTerminator) {
+  std::string buffer("var x = 12.5", 12);
+  buffer += "9;\"abc";
+  Scanner scanner(buffer.data(), 12);
+  EXPECT_EQ(scanner.scanToken().type, TOKEN_VAR);
+  EXPECT_EQ(scanner.scanToken().type, TOKEN_IDENTIFIER);
+  EXPECT_EQ(scanner.scanToken().type, TOKEN_EQUAL);
+  Token number = scanner.scanToken();
+  EXPECT_EQ(number.type, TOKEN_NUMBER);
+  EXPECT_EQ(std::string(number.start, number.length), "12.5");
+  EXPECT_EQ(scanner.scanToken().type, TOKEN_EOF);
+
+  const char withNul[] = "\"a\0b\" \0";
+  Scanner nulScanner(withNul, sizeof(withNul) - 1);
+  Token string = nulScanner.scanToken();
+  EXPECT_EQ(string.type, TOKEN_STRING);
+  EXPECT_EQ(string.length, 5);
+  EXPECT_EQ(nulScanner.scanToken().type, TOKEN_ERROR);
+  EXPECT_EQ(nulScanner.scanToken().type, TOKEN_EOF);
+}
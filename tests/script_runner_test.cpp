@@ -0,0 +1,42 @@
+#include "script_runner.h"
+#include <gtest/gtest.h>
+
+TEST(ScriptRunnerTest, RepeatedScriptsAreCompiledOnce) {
+  std::vector<std::string> sources;
+  for (int i = 0; i < 200; i++) {
+    sources.push_back(i % 2 == 0
+        ? "func twice(n) { return n * 2; } print twice(21);"
+        : "var s = \"ab\"; s = s + s + s; print s;");
+  }
+
+  ScriptRunner runner(4);
+  std::vector<ScriptResult> results = runner.runAll(sources);
+
+  EXPECT_EQ(runner.getRegistry().size(), 2u);
+  for (size_t i = 0; i < results.size(); i++) {
+    EXPECT_EQ(results[i].status, INTERPRET_OK);
+    EXPECT_EQ(results[i].output, i % 2 == 0 ? "-> 42.00\n" : "-> ababab\n");
+  }
+}
+
+TEST(ScriptRunnerTest, JobsDoNotSeeEachOthersGlobals) {
+  ScriptRunner runner(1);
+  testing::internal::CaptureStderr();
+  std::vector<ScriptResult> results = runner.runAll({"var leaked = 1;", "print leaked;"});
+  testing::internal::GetCapturedStderr();
+
+  EXPECT_EQ(results[0].status, INTERPRET_OK);
+  EXPECT_EQ(results[1].status, INTERPRET_RUNTIME_ERROR);
+}
+
+TEST(ScriptRunnerTest, CompileErrorsAreReportedPerJob) {
+  ScriptRunner runner(2);
+  testing::internal::CaptureStderr();
+  std::vector<ScriptResult> results = runner.runAll({"print 1;", "print (;", "print 2;"});
+  testing::internal::GetCapturedStderr();
+
+  EXPECT_EQ(results[0].output, "-> 1.00\n");
+  EXPECT_EQ(results[1].status, INTERPRET_COMPILE_ERROR);
+  EXPECT_EQ(results[2].output, "-> 2.00\n");
+  EXPECT_EQ(runner.getRegistry().size(), 2u);
+}
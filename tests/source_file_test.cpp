@@ -0,0 +1,60 @@
+#include "source_file.h"
+#include "vm.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+static std::string writeTemp(const std::string &contents) {
+  char path[] = "/tmp/asas_source_XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_GE(fd, 0);
+  EXPECT_EQ(write(fd, contents.data(), contents.size()), static_cast<ssize_t>(contents.size()));
+  close(fd);
+  return path;
+}
+
+TEST(SourceFileTest, MapsARegularFile) {
+  std::string path = writeTemp("print 1 + 2;\n");
+  SourceFile file;
+  std::string error;
+  ASSERT_TRUE(file.open(path, error)) << error;
+  EXPECT_TRUE(file.isMapped());
+  EXPECT_EQ(std::string(file.data(), file.size()), "print 1 + 2;\n");
+
+  // the script runs straight from the mapping
+  VM vm;
+  auto sink = std::make_unique<MemoryOutputSink>();
+  MemoryOutputSink *output = sink.get();
+  vm.setOutputSink(std::move(sink));
+  EXPECT_EQ(vm.interpret(file.data(), file.size()), INTERPRET_OK);
+  EXPECT_EQ(output->getContents(), "-> 3.00\n");
+  unlink(path.c_str());
+}
+
+TEST(SourceFileTest, ReadsWhatCantBeMapped) {
+  std::string path = writeTemp("");
+  SourceFile file;
+  std::string error;
+  ASSERT_TRUE(file.open(path, error)) << error;
+  EXPECT_FALSE(file.isMapped());
+  EXPECT_EQ(file.size(), 0u);
+  unlink(path.c_str());
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  ASSERT_EQ(write(fds[1], "var a;", 6), 6);
+  close(fds[1]);
+  ASSERT_TRUE(file.open("/proc/self/fd/" + std::to_string(fds[0]), error)) << error;
+  EXPECT_FALSE(file.isMapped());
+  EXPECT_EQ(std::string(file.data(), file.size()), "var a;");
+  close(fds[0]);
+}
+
+TEST(SourceFileTest, ReportsAMissingFile) {
+  SourceFile file;
+  std::string error;
+  EXPECT_FALSE(file.open("/nonexistent/script.as", error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_EQ(file.size(), 0u);
+}
@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "heap_snapshot.h"
+
+// Lists the objects that retain the most memory in a .heapsnapshot, the
+// ones `asas --heap-snapshot` writes or Chrome DevTools saves.
+static void usage() {
+  fprintf(stderr, "Usage: asas_heap_summary [--top N] file.heapsnapshot\n");
+  exit(64);
+}
+
+int main(int argc, const char *argv[]) {
+  size_t top = HEAP_SUMMARY_DEFAULT_TOP;
+  std::string path;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--top") {
+      if (++i == argc) usage();
+      char *end;
+      long value = strtol(argv[i], &end, 10);
+      if (*end != '\0' || value <= 0) usage();
+      top = static_cast<size_t>(value);
+    } else if (arg.rfind("-", 0) == 0 || !path.empty()) {
+      usage();
+    } else {
+      path = arg;
+    }
+  }
+  if (path.empty()) usage();
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Could not open file \"" << path << "\".\n";
+    return 74;
+  }
+  std::ostringstream buffer;
+  buffer << file.rdbuf();
+
+  HeapSnapshot snapshot;
+  std::string error;
+  if (!HeapSnapshot::parse(buffer.str(), snapshot, error)) {
+    std::cerr << path << ": " << error << "\n";
+    return 65;
+  }
+  std::cout << snapshot.summary(top);
+  return 0;
+}